@@ -0,0 +1,168 @@
+#include "BinLayout.hpp"
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <tuple>
+
+/// index of the bin containing value, which needs to be inside of the borders
+int ArbitraryBins::index(const std::vector<double> &bins, double value)
+{
+    return std::upper_bound(bins.begin(), bins.end(), value) - bins.begin() - 1;
+}
+
+/// arithmetic estimate of the bin containing value, between 0 and last
+int EquidistantBins::guess(int last, double value) const
+{
+    double x = (value - lower) * inv_width;
+    x = x < last ? x : last;
+    x = x > 0 ? x : 0;
+    return static_cast<int>(x);
+}
+
+/// move the estimate idx to the bin containing value, rounding may put it next to it
+int EquidistantBins::correct(const std::vector<double> &bins, double value, int idx)
+{
+    const int last = bins.size() - 2;
+    while(idx < last && bins[idx+1] <= value)
+        ++idx;
+    while(idx > 0 && bins[idx] > value)
+        --idx;
+    return idx;
+}
+
+/// index of the bin containing value, which needs to be inside of the borders
+int EquidistantBins::index(const std::vector<double> &bins, double value) const
+{
+    return correct(bins, value, guess(bins.size() - 2, value));
+}
+
+/// equidistant bins between lower and upper
+BinLayout::BinLayout(int num_bins, double lower, double upper)
+    : m_num_bins(num_bins),
+      equidistant(true)
+{
+    double binwidth = (upper - lower) / num_bins;
+    m_borders.reserve(num_bins + 1);
+    for(int i=0; i<num_bins; ++i)
+        m_borders.emplace_back(lower + i*binwidth);
+    m_borders.emplace_back(upper);
+
+    grid.lower = lower;
+    grid.inv_width = 1. / binwidth;
+
+    m_centers.reserve(num_bins);
+    for(int i=0; i<num_bins; ++i)
+        m_centers.emplace_back((m_borders[i] + m_borders[i+1]) / 2);
+}
+
+/// bins with arbitrary, sorted borders, the bins are found by binary search
+BinLayout::BinLayout(const std::vector<double> &borders)
+    : m_num_bins(borders.empty() ? 0 : borders.size() - 1),
+      m_borders(borders),
+      equidistant(false)
+{
+    m_centers.reserve(m_num_bins);
+    for(int i=0; i<m_num_bins; ++i)
+        m_centers.emplace_back((m_borders[i] + m_borders[i+1]) / 2);
+}
+
+/** Equidistant layout, shared with all histograms of the same binning,
+ * which currently exist.
+ *
+ * Can be called from several threads at once.
+ */
+std::shared_ptr<const BinLayout> BinLayout::equidistantLayout(int num_bins, double lower, double upper)
+{
+    static std::mutex mutex;
+    static std::map<std::tuple<int, double, double>, std::weak_ptr<const BinLayout>> layouts;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto &known = layouts[std::make_tuple(num_bins, lower, upper)];
+    std::shared_ptr<const BinLayout> layout = known.lock();
+    if(layout)
+        return layout;
+
+    // forget layouts, which are not used anymore
+    for(auto it = layouts.begin(); it != layouts.end(); )
+    {
+        if(it->second.expired() && &it->second != &known)
+            it = layouts.erase(it);
+        else
+            ++it;
+    }
+
+    layout = std::make_shared<const BinLayout>(num_bins, lower, upper);
+    known = layout;
+    return layout;
+}
+
+int BinLayout::num_bins() const
+{
+    return m_num_bins;
+}
+
+/// lower border of the first bin
+double BinLayout::lower() const
+{
+    return m_borders.empty() ? 0 : m_borders.front();
+}
+
+/// upper border of the last bin
+double BinLayout::upper() const
+{
+    return m_borders.empty() ? 0 : m_borders.back();
+}
+
+/// vector of of num_bins + 1 elements containing their borders
+const std::vector<double>& BinLayout::borders() const
+{
+    return m_borders;
+}
+
+/// vector of num_bins elements containing their centers
+const std::vector<double>& BinLayout::centers() const
+{
+    return m_centers;
+}
+
+/// index of the bin containing value, which needs to be inside of the borders
+int BinLayout::index(double value) const
+{
+    if(equidistant)
+        return grid.index(m_borders, value);
+    return ArbitraryBins::index(m_borders, value);
+}
+
+/** Find the bins of n values at once.
+ *
+ * Values below the first border get the index num_bins, values above
+ * the last num_bins + 1. The estimates of equidistant bins and the
+ * masks for values outside are computed in branchless loops, which the
+ * compiler can vectorize.
+ */
+void BinLayout::slots(const double *values, int n, int *idx) const
+{
+    const double lower = this->lower();
+    const double upper = this->upper();
+
+    if(equidistant)
+    {
+        const int last = m_num_bins - 1;
+        for(int k=0; k<n; ++k)
+            idx[k] = grid.guess(last, values[k]);
+        for(int k=0; k<n; ++k)
+            idx[k] = EquidistantBins::correct(m_borders, values[k], idx[k]);
+    }
+    else
+    {
+        for(int k=0; k<n; ++k)
+            idx[k] = ArbitraryBins::index(m_borders, std::max(lower, std::min(values[k], upper)));
+    }
+
+    for(int k=0; k<n; ++k)
+    {
+        idx[k] = values[k] < lower ? m_num_bins : idx[k];
+        idx[k] = values[k] >= upper ? m_num_bins + 1 : idx[k];
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+
+/** Bin lookup for arbitrary, sorted bin borders by binary search.
+ */
+struct ArbitraryBins
+{
+    static int index(const std::vector<double> &bins, double value);
+};
+
+/** Bin lookup for equidistant bin borders in constant time.
+ *
+ * The index is calculated arithmetically and afterwards corrected
+ * against the stored borders, such that values on or next to a border
+ * land in exactly the same bin as with ArbitraryBins.
+ */
+struct EquidistantBins
+{
+    double lower;       ///< first border
+    double inv_width;   ///< inverse of the width of a bin
+
+    int guess(int last, double value) const;
+    static int correct(const std::vector<double> &bins, double value, int idx);
+    int index(const std::vector<double> &bins, double value) const;
+};
+
+/** Immutable borders and centers of the bins of histograms.
+ *
+ * Histograms with the same binning share one layout via a shared_ptr,
+ * such that the borders are stored only once and two histograms have
+ * the same borders, if they point to the same layout.
+ */
+class BinLayout
+{
+    protected:
+        int m_num_bins;
+        std::vector<double> m_borders;  ///< num_bins + 1 bin borders
+        std::vector<double> m_centers;  ///< num_bins bin centers
+
+        bool equidistant;               ///< whether the bins can be found by grid
+        EquidistantBins grid;
+
+    public:
+        BinLayout(int num_bins, double lower, double upper);
+        BinLayout(const std::vector<double> &borders);
+
+        static std::shared_ptr<const BinLayout> equidistantLayout(int num_bins, double lower, double upper);
+
+        int num_bins() const;
+        double lower() const;
+        double upper() const;
+        const std::vector<double>& borders() const;
+        const std::vector<double>& centers() const;
+
+        int index(double value) const;
+        void slots(const double *values, int n, int *idx) const;
+};
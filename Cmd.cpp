@@ -1,5 +1,11 @@
 #include "Cmd.hpp"
 
+#include <algorithm>
+
+#include "Decompressor.hpp"
+#include "HistogramCache.hpp"
+#include "Ingestion.hpp"
+
 /** Constructs the command line parser, given argc and argv.
  */
 Cmd::Cmd(int argc, char** argv)
@@ -37,17 +43,23 @@ Cmd::Cmd(int argc, char** argv)
         TCLAP::ValueArg<double> lowerArg("l", "lower", "lower bound", false, -1, "double", cmd);
         TCLAP::ValueArg<int> numBinsArg("B", "bins", "number of bins", false, 100, "int", cmd);
         TCLAP::MultiArg<double> thetaArg("T", "theta", "temperatures corresponding to the input files", false, "double", cmd);
-        TCLAP::ValueArg<int> columnArg("c", "column", "in which column is the data", false, 0, "int", cmd);
+        TCLAP::MultiArg<int> columnArg("c", "column", "in which column is the data, give multiple to evaluate multiple columns in one pass (default: 0)", false, "int", cmd);
         TCLAP::ValueArg<int> skipArg("s", "skip", "how many lines to skip", false, 0, "int", cmd);
         TCLAP::ValueArg<int> stepArg("S", "step", "read only every nth line", false, 0, "int", cmd);
         TCLAP::ValueArg<int> thresholdArg("t", "threshold", "minimum number of entries in bin to use for glueing, or for WL how many bins at the edges to ignore", false, 10, "int", cmd);
         TCLAP::ValueArg<int> parallelArg("p", "parallel", "how many omp threads to use", false, 0, "int", cmd);
+        TCLAP::ValueArg<int> prefetchArg("", "prefetch", "memory in MiB for data decompressed ahead of the evaluation in background threads, 0 to disable", false, 256, "int", cmd);
 
         // switch argument
         // -short, --long, description, default
         TCLAP::SwitchArg bootstrapSwitch("", "bootstrap", "perform bootstrapping to estimate errors of the bins", cmd, false);
         TCLAP::SwitchArg forceSwitch("f", "force", "forces the reevaluation of the raw data", cmd, false);
         TCLAP::SwitchArg quietSwitch("q", "quiet", "quiet mode, log only to file (if specified) and not to stdout", cmd, false);
+        TCLAP::ValueArg<std::string> cacheDirArg("", "cache-dir", "directory for cached histograms, shared by all runs, instead of <input>.hist next to the inputs", false, "", "string", cmd);
+        TCLAP::ValueArg<int> cacheSizeArg("", "cache-size", "size limit of the cache directory in MiB, the least recently used histograms are removed, 0 for no limit", false, 1024, "int", cmd);
+        TCLAP::SwitchArg sampleCacheSwitch("", "sample-cache", "also cache the sorted decimated samples, such that histograms with other bins or borders are derived without reading the data again", cmd, false);
+        TCLAP::SwitchArg concurrentSwitch("", "concurrent", "threads reading the same file fill one shared histogram instead of a copy each, saves memory for very many bins", cmd, false);
+        TCLAP::SwitchArg convertSwitch("", "convert", "convert the input files to the binary column format (<input>.col) and exit", cmd, false);
 
         // Parse the argv array.
         cmd.parse(argc, argv);
@@ -78,19 +90,49 @@ Cmd::Cmd(int argc, char** argv)
         bootstrap = bootstrapSwitch.getValue();
         LOG(LOG_INFO) << "bootstrap                  " << bootstrap;
 
+        convert = convertSwitch.getValue();
+        LOG(LOG_INFO) << "convert                    " << convert;
+
         parallel = parallelArg.getValue();
         if(parallel)
             omp_set_num_threads(parallel);
         LOG(LOG_INFO) << "use parallel threads:      " << omp_get_num_threads();
 
+        prefetch = prefetchArg.getValue();
+        PrefetchDecompressor::setMemoryLimit(static_cast<size_t>(std::max(prefetch, 0)) << 20);
+        LOG(LOG_INFO) << "prefetch memory (MiB)      " << prefetch;
+
+        concurrent = concurrentSwitch.getValue();
+        Ingestion::setConcurrent(concurrent);
+        LOG(LOG_INFO) << "concurrent histograms      " << concurrent;
+
+        cache_dir = cacheDirArg.getValue();
+        cache_size = cacheSizeArg.getValue();
+        HistogramCache::setDirectory(cache_dir, static_cast<uint64_t>(std::max(cache_size, 0)) << 20);
+        LOG(LOG_INFO) << "cache directory            " << cache_dir;
+        LOG(LOG_INFO) << "cache size (MiB)           " << cache_size;
+        sample_cache = sampleCacheSwitch.getValue();
+        LOG(LOG_INFO) << "sample cache               " << sample_cache;
+
         upperBound = upperArg.getValue();
         lowerBound = lowerArg.getValue();
         num_bins = numBinsArg.getValue();
         LOG(LOG_INFO) << "range               [" << lowerBound << ":" << upperBound << "]";
         LOG(LOG_INFO) << "num bins                   " << num_bins;
 
-        column = columnArg.getValue();
-        LOG(LOG_INFO) << "column                     " << column;
+        columns = columnArg.getValue();
+        if(columns.empty())
+            columns.push_back(0);
+        LOG(LOG_INFO) << "columns                    " << columns;
+        // the outputs of the columns are named by them, see columnName()
+        for(size_t c=0; c<columns.size(); ++c)
+        {
+            if(std::count(columns.begin(), columns.begin() + c, columns[c]))
+            {
+                LOG(LOG_ERROR) << "Column " << columns[c] << " is given more than once";
+                exit(5);
+            }
+        }
         skip = skipArg.getValue();
         LOG(LOG_INFO) << "skip                       " << skip;
         step = stepArg.getValue();
@@ -139,6 +181,15 @@ Cmd::Cmd(int argc, char** argv)
                     thetas.erase(thetas.begin()+j);
                 --j;
             }
+            else if(!canDecompress(data_path_vector[j]))
+            {
+                LOG(LOG_ERROR) << "Can not decompress " << data_path_vector[j] << ", compiled without support for its format";
+                LOG(LOG_WARNING) << "evaluate without " << data_path_vector[j];
+                data_path_vector.erase(data_path_vector.begin()+j);
+                if(thetas.size() > 1)
+                    thetas.erase(thetas.begin()+j);
+                --j;
+            }
         }
         LOG(LOG_INFO) << "}";
 
@@ -148,11 +199,14 @@ Cmd::Cmd(int argc, char** argv)
         output = outputArg.getValue();
         if(output != "" && output != "-")
         {
-            std::ofstream os(output);
-            if(!os.good())
+            for(size_t c=0; c<columns.size(); ++c)
             {
-                LOG(LOG_ERROR) << "Can not write " << output;
-                exit(4);
+                std::ofstream os(columnName(output, c));
+                if(!os.good())
+                {
+                    LOG(LOG_ERROR) << "Can not write " << columnName(output, c);
+                    exit(4);
+                }
             }
         }
         LOG(LOG_INFO) << "target path                " << output;
@@ -163,3 +217,21 @@ Cmd::Cmd(int argc, char** argv)
         std::cerr << e.error() << " for arg " << e.argId();
     }
 }
+
+/** Name of an output file for the c-th of the evaluated columns.
+ *
+ * If only one column is evaluated, the name is not changed. Otherwise
+ * the column is inserted in front of the extension, e.g., `out.c2.dat`.
+ */
+std::string Cmd::columnName(const std::string &name, size_t c) const
+{
+    if(columns.size() == 1 || name.empty() || name == "-")
+        return name;
+
+    const std::string tag = ".c" + std::to_string(columns[c]);
+    const size_t slash = name.rfind('/');
+    const size_t dot = name.rfind('.');
+    if(dot == std::string::npos || (slash != std::string::npos && dot < slash) || dot == slash + 1)
+        return name + tag;
+    return name.substr(0, dot) + tag + name.substr(dot);
+}
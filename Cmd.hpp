@@ -13,6 +13,7 @@
 #else
    #define omp_get_thread_num() 0
    #define omp_get_num_threads() 0
+   #define omp_get_max_threads() 1
    #define omp_set_num_threads(x)
 #endif
 
@@ -33,7 +34,7 @@ class Cmd
         std::string text;                             ///< the full command used to start this program
         std::vector<double> thetas;                   ///< temperatures of the files in the same order
 
-        int column;                                   ///< in which column of the file is the interesting data
+        std::vector<int> columns;                     ///< in which columns of the file are the interesting data
         int skip;                                     ///< how many lines to skip of the file (~ equilibration time)
         int step;                                     ///< only read every nth line (~ autocorrelation time)
 
@@ -43,6 +44,14 @@ class Cmd
 
         bool force;
         bool bootstrap;
+        bool convert;
 
         int parallel;
+        int prefetch;                                 ///< memory limit for prefetched data in MiB
+        bool concurrent;                              ///< threads reading one file fill one shared histogram
+        std::string cache_dir;                        ///< directory for cached histograms, empty to save them next to the inputs
+        int cache_size;                               ///< size limit of cache_dir in MiB
+        bool sample_cache;                            ///< also cache the sorted decimated samples
+
+        std::string columnName(const std::string &name, size_t c) const;
 };
@@ -0,0 +1,327 @@
+#include "ColumnFile.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include "fileOp.hpp"
+#include "HistogramCache.hpp"
+#include "Logging.hpp"
+
+/// identifies column files and their version
+static const char COLUMN_MAGIC[8] = {'G', 'L', 'U', 'E', 'C', 'O', 'L', '1'};
+
+/// header of a column file, followed by the names and the columns
+struct ColumnHeader
+{
+    char magic[8];
+    uint32_t num_columns;
+    uint32_t dtype;
+    uint64_t num_rows;
+    uint64_t data_offset;   ///< offset of the first column, aligned to 8 bytes
+};
+
+/** Map a column file.
+ *
+ * \param filename  file to read
+ */
+ColumnFile::ColumnFile(const std::string &filename)
+    : file(filename),
+      m_good(false),
+      m_rows(0),
+      m_dtype(FLOAT64),
+      data_offset(0)
+{
+    const std::string_view all = file.view();
+    if(!file.good() || all.size() < sizeof(ColumnHeader))
+        return;
+
+    ColumnHeader header;
+    std::memcpy(&header, all.data(), sizeof(header));
+    if(std::memcmp(header.magic, COLUMN_MAGIC, sizeof(COLUMN_MAGIC)) != 0)
+        return;
+    if(header.dtype != FLOAT64 && header.dtype != FLOAT32)
+    {
+        LOG(LOG_ERROR) << "unknown type of values " << header.dtype << " in " << filename;
+        return;
+    }
+
+    m_rows = header.num_rows;
+    m_dtype = static_cast<Dtype>(header.dtype);
+    data_offset = header.data_offset;
+
+    size_t pos = sizeof(header);
+    for(uint32_t k=0; k<header.num_columns; ++k)
+    {
+        uint32_t len;
+        if(pos + sizeof(len) > all.size())
+            return;
+        std::memcpy(&len, all.data() + pos, sizeof(len));
+        pos += sizeof(len);
+        if(pos + len > all.size())
+            return;
+        names.emplace_back(all.substr(pos, len));
+        pos += len;
+    }
+
+    // the values are read as double or float from the mapping, so they are aligned
+    if(data_offset < pos || data_offset > all.size() || data_offset % 8)
+    {
+        LOG(LOG_ERROR) << "corrupt column file " << filename;
+        return;
+    }
+    // divide instead of multiply, such that huge numbers can not wrap around
+    if(!names.empty() && m_rows > (all.size() - data_offset) / (names.size() * valueSize()))
+    {
+        LOG(LOG_ERROR) << "truncated column file " << filename;
+        return;
+    }
+    m_good = true;
+}
+
+/// whether the file is a valid column file
+bool ColumnFile::good() const
+{
+    return m_good;
+}
+
+/// number of rows, i.e., data lines
+size_t ColumnFile::rows() const
+{
+    return m_rows;
+}
+
+/// number of columns
+int ColumnFile::columns() const
+{
+    return names.size();
+}
+
+/// type of the values
+ColumnFile::Dtype ColumnFile::dtype() const
+{
+    return m_dtype;
+}
+
+/// name of the given column, e.g., from the header of the text file
+const std::string& ColumnFile::name(int column) const
+{
+    return names[column];
+}
+
+/// size of one value in bytes
+size_t ColumnFile::valueSize() const
+{
+    return m_dtype == FLOAT32 ? sizeof(float) : sizeof(double);
+}
+
+/// offset of the values of the given column in the file
+size_t ColumnFile::offset(int column) const
+{
+    return data_offset + column * m_rows * valueSize();
+}
+
+/// values of the given column, of type dtype()
+const void* ColumnFile::data(int column) const
+{
+    return file.view().data() + offset(column);
+}
+
+/// name of the column file a text file is converted to
+std::string ColumnFile::fileName(const std::string &filename)
+{
+    return filename + ".col";
+}
+
+/// tests if the given file is a column file, by its magic bytes
+bool ColumnFile::isColumnFile(const std::string &filename)
+{
+    std::ifstream is(filename, std::ios::binary);
+    char magic[sizeof(COLUMN_MAGIC)] = {};
+    is.read(magic, sizeof(magic));
+    return is.good() && std::memcmp(magic, COLUMN_MAGIC, sizeof(COLUMN_MAGIC)) == 0;
+}
+
+/** Write the values of a block of rows to the scratch file of convert().
+ *
+ * The values of every column are written contiguously, such that the
+ * scratch file is a sequence of blocks, which are column major.
+ */
+static void writeBlock(std::ofstream &os, std::vector<std::vector<double>> &block)
+{
+    for(auto &column : block)
+    {
+        os.write(reinterpret_cast<const char*>(column.data()), column.size() * sizeof(double));
+        column.clear();
+    }
+}
+
+/** Convert a (compressed) text file into a column file in a single pass.
+ *
+ * The number of columns is given by the first data line, the names of
+ * the columns are taken from the comment line in front of it, if it
+ * has a word for every column. The values are stored as double, exactly
+ * as they are parsed from the text. Like reading the text, a word, which
+ * is missing or no number, is an error.
+ *
+ * Only a block of rows is held in memory. The blocks are written to a
+ * scratch file next to the target, from which the columns are gathered,
+ * once the number of rows is known.
+ *
+ * \param filename  text file to convert
+ * \param target    column file to write
+ * \return false, if the file could not be converted
+ */
+bool ColumnFile::convert(const std::string &filename, const std::string &target)
+{
+    LineReader reader(PrefetchDecompressor::wrap(openDecompressor(filename)));
+    if(!reader.good())
+        return false;
+
+    const std::string scratch = HistogramCache::temporaryName(target + ".rows");
+    std::ofstream blocks(scratch, std::ios::binary);
+    if(!blocks.good())
+    {
+        LOG(LOG_ERROR) << "Can not write " << scratch;
+        return false;
+    }
+
+    std::string_view line;
+    std::string comment;    // last comment line in front of the data
+    std::vector<std::string> names;
+    std::vector<std::vector<double>> block;
+    size_t block_rows = 0;  // rows of all but the last block
+    uint64_t rows = 0;
+    uint64_t line_number = 0;
+    while(reader.getline(line))
+    {
+        ++line_number;
+        if(line.empty())
+            continue;
+        if(line[0] == '#')
+        {
+            if(block.empty())
+                comment = line.substr(1);
+            continue;
+        }
+
+        if(block.empty())
+        {
+            // words are separated by single spaces, as in nthWord
+            block.resize(std::count(line.begin(), line.end(), ' ') + 1);
+            // about 8 MiB per block
+            block_rows = std::max<size_t>(1, (1 << 20) / block.size());
+
+            size_t begin = 0;
+            while((begin = comment.find_first_not_of(" \t\r", begin)) != std::string::npos)
+            {
+                size_t end = std::min(comment.size(), comment.find_first_of(" \t\r", begin));
+                names.push_back(comment.substr(begin, end - begin));
+                begin = end;
+            }
+            if(names.size() != block.size())
+            {
+                names.clear();
+                for(size_t k=0; k<block.size(); ++k)
+                    names.push_back(std::to_string(k));
+            }
+        }
+
+        size_t begin = 0;
+        for(auto &column : block)
+        {
+            if(begin > line.size())
+            {
+                LOG(LOG_ERROR) << "line " << line_number << " of " << filename << " has less than " << block.size() << " words";
+                blocks.close();
+                std::remove(scratch.c_str());
+                return false;
+            }
+            size_t end = std::min(line.size(), line.find(' ', begin));
+            try
+            {
+                column.push_back(toDouble(line.substr(begin, end - begin)));
+            }
+            catch(std::exception &e)
+            {
+                LOG(LOG_ERROR) << "line " << line_number << " of " << filename << ": " << e.what();
+                blocks.close();
+                std::remove(scratch.c_str());
+                return false;
+            }
+            begin = end + 1;
+        }
+
+        if(++rows % block_rows == 0)
+            writeBlock(blocks, block);
+    }
+    writeBlock(blocks, block);
+    blocks.close();
+    if(!blocks.good())
+    {
+        LOG(LOG_ERROR) << "Can not write " << scratch;
+        std::remove(scratch.c_str());
+        return false;
+    }
+
+    ColumnHeader header;
+    std::memcpy(header.magic, COLUMN_MAGIC, sizeof(COLUMN_MAGIC));
+    header.num_columns = block.size();
+    header.dtype = FLOAT64;
+    header.num_rows = rows;
+    header.data_offset = sizeof(header);
+    for(const auto &name : names)
+        header.data_offset += sizeof(uint32_t) + name.size();
+    header.data_offset = (header.data_offset + 7) / 8 * 8;
+
+    const std::string tmp = HistogramCache::temporaryName(target);
+    std::ofstream os(tmp, std::ios::binary);
+    std::ifstream is(scratch, std::ios::binary);
+    if(!os.good() || !is.good())
+    {
+        LOG(LOG_ERROR) << "Can not write " << target;
+        std::remove(scratch.c_str());
+        return false;
+    }
+
+    os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    size_t pos = sizeof(header);
+    for(const auto &name : names)
+    {
+        uint32_t len = name.size();
+        os.write(reinterpret_cast<const char*>(&len), sizeof(len));
+        os.write(name.data(), len);
+        pos += sizeof(len) + len;
+    }
+    os.write("\0\0\0\0\0\0\0", header.data_offset - pos);
+
+    // gather every column from the blocks, the last one may be shorter
+    const uint64_t block_size = block_rows * block.size() * sizeof(double);
+    std::vector<double> values(block_rows);
+    for(size_t k=0; k<block.size(); ++k)
+    {
+        for(uint64_t first=0; first<rows; first+=block_rows)
+        {
+            const uint64_t n = std::min<uint64_t>(block_rows, rows - first);
+            is.seekg(first / block_rows * block_size + k * n * sizeof(double));
+            is.read(reinterpret_cast<char*>(values.data()), n * sizeof(double));
+            os.write(reinterpret_cast<const char*>(values.data()), n * sizeof(double));
+        }
+    }
+    const bool read = is.good();
+    is.close();
+    os.close();
+    std::remove(scratch.c_str());
+    HistogramCache::replace(tmp, target, read && os.good());
+    if(!read || !os.good())
+    {
+        LOG(LOG_ERROR) << "Can not write " << target;
+        return false;
+    }
+
+    LOG(LOG_INFO) << "converted " << filename << " to " << target << ": "
+                  << header.num_rows << " rows, " << header.num_columns << " columns";
+    return true;
+}
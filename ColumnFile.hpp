@@ -0,0 +1,54 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "MappedFile.hpp"
+
+/** Binary columnar file of a simulation time series.
+ *
+ * The file starts with a header containing the number of columns, the
+ * type of the values and the number of rows, followed by the names of
+ * the columns. The values of every column follow as one contiguous
+ * array, such that one column can be read directly from a memory
+ * mapping, without any parsing.
+ *
+ * Every row corresponds to one data line of the text file the column
+ * file was converted from by convert().
+ */
+class ColumnFile
+{
+    public:
+        /// type of the values
+        enum Dtype : uint32_t
+        {
+            FLOAT64 = 0,
+            FLOAT32 = 1
+        };
+
+        ColumnFile(const std::string &filename);
+
+        bool good() const;
+        size_t rows() const;
+        int columns() const;
+        Dtype dtype() const;
+        const std::string& name(int column) const;
+
+        const void* data(int column) const;
+        size_t offset(int column) const;
+
+        static std::string fileName(const std::string &filename);
+        static bool isColumnFile(const std::string &filename);
+        static bool convert(const std::string &filename, const std::string &target);
+
+    protected:
+        MappedFile file;
+        bool m_good;
+        size_t m_rows;
+        Dtype m_dtype;
+        size_t data_offset;             ///< offset of the first column
+        std::vector<std::string> names;
+
+        size_t valueSize() const;
+};
@@ -0,0 +1,74 @@
+#include "ConcurrentHistogram.hpp"
+
+/// empty histogram with the bins of layout
+ConcurrentHistogram::ConcurrentHistogram(std::shared_ptr<const BinLayout> layout)
+    : num_bins(layout->num_bins()),
+      m_layout(std::move(layout)),
+      counts(new std::atomic<uint64_t>[num_bins + 2])
+{
+    reset();
+}
+
+/// count one value, can be called from several threads at once
+void ConcurrentHistogram::add(double where)
+{
+    int idx;
+    m_layout->slots(&where, 1, &idx);
+    counts[idx].fetch_add(1, std::memory_order_relaxed);
+}
+
+/// count all values from begin to end, can be called from several threads at once
+void ConcurrentHistogram::add(const double *begin, const double *end)
+{
+    const int block = 256;
+    int idx[block];
+    for(const double *pos=begin; pos<end; pos+=block)
+    {
+        const int m = std::min<ptrdiff_t>(block, end - pos);
+        m_layout->slots(pos, m, idx);
+        for(int k=0; k<m; ++k)
+            counts[idx[k]].fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+int ConcurrentHistogram::get_num_bins() const
+{
+    return num_bins;
+}
+
+/// set all counts to zero, must not be called while other threads add
+void ConcurrentHistogram::reset()
+{
+    for(int i=0; i<num_bins+2; ++i)
+        counts[i].store(0, std::memory_order_relaxed);
+}
+
+/** Add the counts to a histogram with the same bins.
+ *
+ * All threads need to be done adding.
+ */
+template<class Count>
+void ConcurrentHistogram::addTo(BasicHistogram<Count> &hist) const
+{
+    if(num_bins != hist.num_bins)
+    {
+        LOG(LOG_ERROR) << "can not add histograms with " << hist.num_bins
+                       << " and " << num_bins << " bins";
+        return;
+    }
+
+    for(int i=0; i<num_bins; ++i)
+    {
+        const uint64_t count = counts[i].load(std::memory_order_relaxed);
+        if(!count)
+            continue;
+        hist.bin(i) += count;
+        hist.m_total += count;
+        hist.m_sum += count;
+    }
+    hist.below += counts[num_bins].load(std::memory_order_relaxed);
+    hist.above += counts[num_bins + 1].load(std::memory_order_relaxed);
+}
+
+template void ConcurrentHistogram::addTo(BasicHistogram<double> &hist) const;
+template void ConcurrentHistogram::addTo(BasicHistogram<uint64_t> &hist) const;
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <cstdint>
+
+#include "Histogram.hpp"
+
+/** Histogram, which can be filled from many threads at once.
+ *
+ * The bins are atomic counters, which are incremented with relaxed
+ * ordering. Threads evaluating parts of the same data can fill one
+ * histogram instead of a copy each, which is merged afterwards. This
+ * saves the memory of the copies for very many bins. With few bins,
+ * the threads contend for the same cache lines and copies are faster.
+ *
+ * The counts are added to a regular histogram of the same layout by
+ * addTo(), e.g., for glueing.
+ */
+class ConcurrentHistogram
+{
+    protected:
+        int num_bins;
+        std::shared_ptr<const BinLayout> m_layout;
+        std::unique_ptr<std::atomic<uint64_t>[]> counts;  ///< num_bins bins, followed by below and above
+
+    public:
+        ConcurrentHistogram(std::shared_ptr<const BinLayout> layout);
+
+        void add(double where);
+        void add(const double *begin, const double *end);
+
+        int get_num_bins() const;
+        void reset();
+
+        template<class Count>
+        void addTo(BasicHistogram<Count> &hist) const;
+};
@@ -0,0 +1,689 @@
+#include "Decompressor.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "Logging.hpp"
+
+/** Open a file for reading and announce that we read it sequentially.
+ *
+ * \return file descriptor, negative on error
+ */
+static int openSequential(const std::string &filename)
+{
+    int fd = open(filename.c_str(), O_RDONLY);
+    if(fd >= 0)
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    return fd;
+}
+
+/** Read as many bytes as possible (up to n), retry on interrupts.
+ *
+ * \return number of bytes read, 0 at the end of the file or on errors
+ */
+static size_t readFully(int fd, char *buf, size_t n)
+{
+    size_t total = 0;
+    while(total < n)
+    {
+        ssize_t r = ::read(fd, buf + total, n - total);
+        if(r < 0 && errno == EINTR)
+            continue;
+        if(r <= 0)
+            break;
+        total += r;
+    }
+    return total;
+}
+
+/** Read the next chunk of compressed data and ask the kernel to already
+ * read the following chunks in the background, such that the disk keeps
+ * streaming while we decompress.
+ */
+static size_t readChunk(int fd, char *buf, size_t n)
+{
+    const size_t r = readFully(fd, buf, n);
+    const off_t next = lseek(fd, 0, SEEK_CUR);
+    if(r == n && next >= 0)
+        posix_fadvise(fd, next, 4*n, POSIX_FADV_WILLNEED);
+    return r;
+}
+
+PlainDecompressor::PlainDecompressor(const std::string &filename)
+    : fd(openSequential(filename))
+{
+}
+
+PlainDecompressor::~PlainDecompressor()
+{
+    if(fd >= 0)
+        close(fd);
+}
+
+size_t PlainDecompressor::read(char *buf, size_t n)
+{
+    if(fd < 0)
+        return 0;
+    return readFully(fd, buf, n);
+}
+
+bool PlainDecompressor::good() const
+{
+    return fd >= 0;
+}
+
+/** Open a gzip file for inflating.
+ *
+ * \param filename      file to read
+ * \param chunk_size    how many compressed bytes to read at once
+ */
+GzipDecompressor::GzipDecompressor(const std::string &filename, size_t chunk_size)
+    : fd(openSequential(filename)),
+      strm(),
+      in(chunk_size),
+      input_done(false),
+      stream_done(false),
+      members(0),
+      first_member_only(false),
+      m_good(fd >= 0),
+      index(nullptr),
+      last_point(0)
+{
+    // 15 + 32: maximum window size, detect gzip or zlib header
+    if(inflateInit2(&strm, 15 + 32) != Z_OK)
+    {
+        LOG(LOG_ERROR) << "can not initialize zlib for " << filename;
+        m_good = false;
+    }
+}
+
+GzipDecompressor::~GzipDecompressor()
+{
+    inflateEnd(&strm);
+    if(fd >= 0)
+        close(fd);
+}
+
+/** Record seek points into the given index while inflating.
+ *
+ * Needs to be called before the first read().
+ */
+void GzipDecompressor::recordIndex(GzipIndex *index)
+{
+    this->index = index;
+}
+
+/** Count the lines of the newly inflated data and add a seek point, if
+ * we are at a block boundary far enough from the last point.
+ */
+void GzipDecompressor::record(const char *out, size_t n)
+{
+    counter.scan(out, n);
+
+    // points are only valid inside of the first gzip member
+    if(members)
+    {
+        if(n)
+            index->setIncomplete();
+        return;
+    }
+
+    // 128: at the end of a block, 64: the last block
+    if((strm.data_type & 128) && !(strm.data_type & 64)
+        && strm.total_out - last_point >= index->span())
+    {
+        unsigned char window[32768];
+        uInt len = sizeof(window);
+        inflateGetDictionary(&strm, window, &len);
+        index->addPoint(strm.total_out, strm.total_in, strm.data_type & 7, counter, window, len);
+        last_point = strm.total_out;
+    }
+}
+
+/// read the next chunk of compressed data, false if there is none
+bool GzipDecompressor::fill()
+{
+    if(input_done)
+        return false;
+
+    size_t r = readChunk(fd, reinterpret_cast<char*>(in.data()), in.size());
+    if(r < in.size())
+        input_done = true;
+    strm.next_in = in.data();
+    strm.avail_in = r;
+    return r > 0;
+}
+
+size_t GzipDecompressor::read(char *buf, size_t n)
+{
+    if(!m_good || stream_done)
+        return 0;
+
+    strm.next_out = reinterpret_cast<unsigned char*>(buf);
+    strm.avail_out = n;
+    while(strm.avail_out)
+    {
+        if(!strm.avail_in && !fill())
+        {
+            if(strm.total_in)
+            {
+                LOG(LOG_WARNING) << "unexpected end of compressed data";
+            }
+            stream_done = true;
+            break;
+        }
+
+        const unsigned char *out = strm.next_out;
+        // stop at every block boundary, if we need to record seek points
+        int ret = inflate(&strm, index ? Z_BLOCK : Z_NO_FLUSH);
+        if(index)
+            record(reinterpret_cast<const char*>(out), strm.next_out - out);
+
+        if(ret == Z_STREAM_END && first_member_only)
+        {
+            stream_done = true;
+            break;
+        }
+        else if(ret == Z_STREAM_END)
+        {
+            // there may be another gzip member concatenated to this one
+            ++members;
+            inflateReset(&strm);
+        }
+        else if(ret == Z_DATA_ERROR && members && !strm.total_out)
+        {
+            // like gzread: ignore trailing garbage after the last member
+            stream_done = true;
+            break;
+        }
+        else if(ret != Z_OK && ret != Z_BUF_ERROR)
+        {
+            LOG(LOG_ERROR) << "error while inflating: " << (strm.msg ? strm.msg : "unknown");
+            m_good = false;
+            stream_done = true;
+            break;
+        }
+    }
+
+    return n - strm.avail_out;
+}
+
+bool GzipDecompressor::good() const
+{
+    return m_good;
+}
+
+/** Prepare inflating the k-th segment of a gzip file.
+ *
+ * Segment 0 starts at the beginning of the file, segment k > 0 at the
+ * (k-1)-th seek point of the index. The last segment ends at the end of
+ * the (only) gzip member, all others at the next seek point.
+ */
+GzipSegmentDecompressor::GzipSegmentDecompressor(const std::string &filename, const GzipIndex &index, size_t k)
+    : GzipDecompressor(filename),
+      offset(0),
+      length(-1),
+      skip_partial(false),
+      done(false)
+{
+    first_member_only = true;
+
+    const auto &points = index.points();
+    if(k < points.size())
+        length = points[k].out - (k ? points[k-1].out : 0);
+
+    if(k == 0 || !m_good)
+        return;
+
+    // resume raw inflating at the seek point
+    const auto &p = points[k-1];
+    skip_partial = !p.line_start;
+    inflateEnd(&strm);
+    strm = z_stream();
+    inflateInit2(&strm, -15);
+
+    lseek(fd, p.in - (p.bits ? 1 : 0), SEEK_SET);
+    if(p.bits)
+    {
+        char c;
+        readFully(fd, &c, 1);
+        inflatePrime(&strm, p.bits, static_cast<unsigned char>(c) >> (8 - p.bits));
+    }
+    std::vector<unsigned char> window = index.window(k-1);
+    inflateSetDictionary(&strm, window.data(), window.size());
+}
+
+size_t GzipSegmentDecompressor::read(char *buf, size_t n)
+{
+    while(!done)
+    {
+        const size_t got = GzipDecompressor::read(buf, n);
+        if(!got)
+        {
+            done = true;
+            break;
+        }
+
+        // keep buf[begin, end)
+        size_t begin = 0;
+        size_t end = got;
+        if(skip_partial)
+        {
+            const char *nl = static_cast<const char*>(std::memchr(buf, '\n', got));
+            if(!nl)
+            {
+                offset += got;
+                continue;
+            }
+            begin = nl - buf + 1;
+            skip_partial = false;
+
+            // the partial line covers the whole segment
+            if(offset + begin >= length)
+            {
+                done = true;
+                break;
+            }
+        }
+
+        // the line containing the last byte of the segment is completed,
+        // lines starting after it belong to the next segment
+        if(offset + end > length - 1)
+        {
+            // the line may have crossed the last byte in an earlier read
+            const size_t from = offset >= length - 1 ? begin : std::max(begin, static_cast<size_t>(length - 1 - offset));
+            const char *nl = static_cast<const char*>(std::memchr(buf + from, '\n', end - from));
+            if(nl)
+            {
+                end = nl - buf + 1;
+                done = true;
+            }
+        }
+        offset += got;
+
+        std::memmove(buf, buf + begin, end - begin);
+        if(end > begin)
+            return end - begin;
+    }
+    return 0;
+}
+
+#ifdef HAVE_ZSTD
+/** Open a zstd file for decompression.
+ *
+ * \param filename      file to read
+ * \param chunk_size    how many compressed bytes to read at once
+ */
+ZstdDecompressor::ZstdDecompressor(const std::string &filename, size_t chunk_size)
+    : fd(openSequential(filename)),
+      stream(ZSTD_createDStream()),
+      in(chunk_size),
+      input{in.data(), 0, 0},
+      input_done(false),
+      hint(0),
+      m_good(fd >= 0 && stream)
+{
+}
+
+ZstdDecompressor::~ZstdDecompressor()
+{
+    ZSTD_freeDStream(stream);
+    if(fd >= 0)
+        close(fd);
+}
+
+/// read the next chunk of compressed data, false if there is none
+bool ZstdDecompressor::fill()
+{
+    if(input_done)
+        return false;
+
+    size_t r = readChunk(fd, in.data(), in.size());
+    if(r < in.size())
+        input_done = true;
+    input = {in.data(), r, 0};
+    return r > 0;
+}
+
+size_t ZstdDecompressor::read(char *buf, size_t n)
+{
+    ZSTD_outBuffer output = {buf, n, 0};
+    while(m_good && output.pos < output.size)
+    {
+        if(input.pos == input.size && !fill())
+        {
+            if(hint)
+            {
+                LOG(LOG_WARNING) << "unexpected end of compressed data";
+            }
+            break;
+        }
+
+        hint = ZSTD_decompressStream(stream, &output, &input);
+        if(ZSTD_isError(hint))
+        {
+            LOG(LOG_ERROR) << "error while decompressing: " << ZSTD_getErrorName(hint);
+            m_good = false;
+        }
+    }
+
+    return output.pos;
+}
+
+bool ZstdDecompressor::good() const
+{
+    return m_good;
+}
+#endif
+
+#ifdef HAVE_LZ4
+/** Open a lz4 file for decompression.
+ *
+ * \param filename      file to read
+ * \param chunk_size    how many compressed bytes to read at once
+ */
+Lz4Decompressor::Lz4Decompressor(const std::string &filename, size_t chunk_size)
+    : fd(openSequential(filename)),
+      dctx(nullptr),
+      in(chunk_size),
+      pos(0),
+      len(0),
+      input_done(false),
+      hint(0),
+      m_good(fd >= 0)
+{
+    if(LZ4F_isError(LZ4F_createDecompressionContext(&dctx, LZ4F_VERSION)))
+    {
+        LOG(LOG_ERROR) << "can not initialize lz4 for " << filename;
+        m_good = false;
+    }
+}
+
+Lz4Decompressor::~Lz4Decompressor()
+{
+    LZ4F_freeDecompressionContext(dctx);
+    if(fd >= 0)
+        close(fd);
+}
+
+/// read the next chunk of compressed data, false if there is none
+bool Lz4Decompressor::fill()
+{
+    if(input_done)
+        return false;
+
+    len = readChunk(fd, in.data(), in.size());
+    pos = 0;
+    if(len < in.size())
+        input_done = true;
+    return len > 0;
+}
+
+size_t Lz4Decompressor::read(char *buf, size_t n)
+{
+    size_t total = 0;
+    while(m_good && total < n)
+    {
+        if(pos == len && !fill())
+        {
+            if(hint)
+            {
+                LOG(LOG_WARNING) << "unexpected end of compressed data";
+            }
+            break;
+        }
+
+        size_t out_size = n - total;
+        size_t in_size = len - pos;
+        hint = LZ4F_decompress(dctx, buf + total, &out_size, in.data() + pos, &in_size, nullptr);
+        if(LZ4F_isError(hint))
+        {
+            LOG(LOG_ERROR) << "error while decompressing: " << LZ4F_getErrorName(hint);
+            m_good = false;
+        }
+        pos += in_size;
+        total += out_size;
+    }
+
+    return total;
+}
+
+bool Lz4Decompressor::good() const
+{
+    return m_good;
+}
+#endif
+
+size_t PrefetchDecompressor::memory_limit = 256 << 20;
+size_t PrefetchDecompressor::memory_used = 0;
+std::mutex PrefetchDecompressor::memory_mutex;
+std::condition_variable PrefetchDecompressor::memory_freed;
+
+/** Start decompressing source in the background.
+ *
+ * \param source      decompressor to read ahead from
+ * \param block_size  size of the prefetched blocks
+ * \param max_blocks  how many blocks may wait for the reader
+ */
+PrefetchDecompressor::PrefetchDecompressor(std::unique_ptr<Decompressor> source, size_t block_size, size_t max_blocks)
+    : source(std::move(source)),
+      block_size(block_size),
+      max_blocks(max_blocks),
+      pos(0),
+      blocks(0),
+      source_done(false),
+      source_good(this->source->good()),
+      stop(false)
+{
+    worker = std::thread(&PrefetchDecompressor::produce, this);
+}
+
+/// stops the background thread, also if not everything was read
+PrefetchDecompressor::~PrefetchDecompressor()
+{
+    {
+        std::lock_guard<std::mutex> lock(memory_mutex);
+        stop = true;
+    }
+    memory_freed.notify_all();
+    worker.join();
+    release(blocks);
+}
+
+/** Limit the memory of all prefetched blocks of all instances.
+ *
+ * Every instance may always prefetch one block, such that every reader
+ * makes progress. A limit of 0 disables prefetching in wrap().
+ */
+void PrefetchDecompressor::setMemoryLimit(size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(memory_mutex);
+    memory_limit = bytes;
+}
+
+/// prefetch from source, unless prefetching is disabled
+std::unique_ptr<Decompressor> PrefetchDecompressor::wrap(std::unique_ptr<Decompressor> source)
+{
+    {
+        std::lock_guard<std::mutex> lock(memory_mutex);
+        if(!memory_limit)
+            return source;
+    }
+    return std::unique_ptr<Decompressor>(new PrefetchDecompressor(std::move(source)));
+}
+
+/// give n consumed blocks back to the memory limit
+void PrefetchDecompressor::release(size_t n)
+{
+    if(!n)
+        return;
+    {
+        std::lock_guard<std::mutex> lock(memory_mutex);
+        blocks -= n;
+        memory_used -= n * block_size;
+    }
+    memory_freed.notify_all();
+}
+
+/// background thread: decompress blocks into the queue until the source is exhausted
+void PrefetchDecompressor::produce()
+{
+    for(;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(memory_mutex);
+            memory_freed.wait(lock, [&]{
+                return stop || !blocks
+                    || (blocks < max_blocks && memory_used + block_size <= memory_limit);
+            });
+            if(stop)
+                return;
+            ++blocks;
+            memory_used += block_size;
+        }
+
+        std::vector<char> block(block_size);
+        const size_t n = source->read(block.data(), block.size());
+        block.resize(n);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if(n)
+                queue.push_back(std::move(block));
+            else
+            {
+                source_done = true;
+                source_good = source->good();
+            }
+        }
+        ready.notify_one();
+
+        if(!n)
+        {
+            release(1);
+            return;
+        }
+    }
+}
+
+size_t PrefetchDecompressor::read(char *buf, size_t n)
+{
+    size_t total = 0;
+    while(total < n)
+    {
+        if(pos == current.size())
+        {
+            if(!current.empty())
+            {
+                current.clear();
+                pos = 0;
+                release(1);
+            }
+
+            std::unique_lock<std::mutex> lock(mutex);
+            ready.wait(lock, [&]{ return !queue.empty() || source_done; });
+            if(queue.empty())
+                break;
+            current = std::move(queue.front());
+            queue.pop_front();
+            pos = 0;
+        }
+
+        const size_t len = std::min(n - total, current.size() - pos);
+        std::memcpy(buf + total, current.data() + pos, len);
+        pos += len;
+        total += len;
+    }
+    return total;
+}
+
+/// whether the source had no error, known once it is exhausted
+bool PrefetchDecompressor::good() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return source_good;
+}
+
+/** Detect the compression of a file by its magic bytes.
+ *
+ * Files without known magic bytes are assumed to be uncompressed.
+ */
+Compression detectCompression(const std::string &filename)
+{
+    unsigned char magic[4] = {0, 0, 0, 0};
+    int fd = open(filename.c_str(), O_RDONLY);
+    if(fd >= 0)
+    {
+        readFully(fd, reinterpret_cast<char*>(magic), 4);
+        close(fd);
+    }
+
+    if(magic[0] == 0x1f && magic[1] == 0x8b)
+        return Compression::Gzip;
+    if(magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd)
+        return Compression::Zstd;
+    if(magic[0] == 0x04 && magic[1] == 0x22 && magic[2] == 0x4d && magic[3] == 0x18)
+        return Compression::Lz4;
+    return Compression::None;
+}
+
+/// whether support for the compression of the file is compiled in
+bool canDecompress(const std::string &filename)
+{
+    const Compression format = detectCompression(filename);
+    #ifndef HAVE_ZSTD
+    if(format == Compression::Zstd)
+        return false;
+    #endif
+    #ifndef HAVE_LZ4
+    if(format == Compression::Lz4)
+        return false;
+    #endif
+    (void) format;
+    return true;
+}
+
+/** Shell command writing the decompressed file to stdout, e.g., for
+ * gnuplot. Empty for uncompressed files.
+ */
+std::string decompressCommand(const std::string &filename)
+{
+    switch(detectCompression(filename))
+    {
+        case Compression::Gzip:
+            return "zcat";
+        case Compression::Zstd:
+            return "zstdcat";
+        case Compression::Lz4:
+            return "lz4cat";
+        default:
+            return "";
+    }
+}
+
+/** Open a file with the decompressor matching its format.
+ *
+ * The format is detected by the magic bytes, files without known magic
+ * bytes are considered to be uncompressed.
+ */
+std::unique_ptr<Decompressor> openDecompressor(const std::string &filename)
+{
+    switch(detectCompression(filename))
+    {
+        case Compression::Gzip:
+            return std::unique_ptr<Decompressor>(new GzipDecompressor(filename));
+        #ifdef HAVE_ZSTD
+        case Compression::Zstd:
+            return std::unique_ptr<Decompressor>(new ZstdDecompressor(filename));
+        #endif
+        #ifdef HAVE_LZ4
+        case Compression::Lz4:
+            return std::unique_ptr<Decompressor>(new Lz4Decompressor(filename));
+        #endif
+        default:
+            return std::unique_ptr<Decompressor>(new PlainDecompressor(filename));
+    }
+}
@@ -0,0 +1,228 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include <zlib.h>
+#ifdef HAVE_ZSTD
+    #include <zstd.h>
+#endif
+#ifdef HAVE_LZ4
+    #include <lz4frame.h>
+#endif
+
+#include "GzipIndex.hpp"
+
+/// formats of input files, detected by their magic bytes
+enum class Compression
+{
+    None,
+    Gzip,
+    Zstd,
+    Lz4
+};
+
+/** Source of (decompressed) data, read in large blocks.
+ *
+ * Implementations exist for the different formats of input files,
+ * openDecompressor() selects the right one by the magic bytes.
+ */
+class Decompressor
+{
+    public:
+        virtual ~Decompressor() {}
+
+        /** Read up to n decompressed bytes into buf.
+         *
+         * \return number of bytes read, 0 at the end of the data
+         */
+        virtual size_t read(char *buf, size_t n) = 0;
+
+        /// whether the file could be opened and no error occured
+        virtual bool good() const = 0;
+};
+
+/// Passes uncompressed files through.
+class PlainDecompressor : public Decompressor
+{
+    protected:
+        int fd;
+
+    public:
+        PlainDecompressor(const std::string &filename);
+        ~PlainDecompressor();
+
+        size_t read(char *buf, size_t n) override;
+        bool good() const override;
+};
+
+/** Inflates gzip files (also concatenated members) with zlib.
+ *
+ * The compressed data is read in large chunks and inflated directly into
+ * the large blocks of the caller, such that zlib can stay in its fast
+ * decoding loop almost all of the time.
+ *
+ * On the way, it can record a GzipIndex of the file.
+ */
+class GzipDecompressor : public Decompressor
+{
+    protected:
+        int fd;
+        z_stream strm;
+        std::vector<unsigned char> in;  ///< buffer for compressed data
+        bool input_done;                ///< all compressed data is read
+        bool stream_done;               ///< no more decompressed data
+        int members;                    ///< number of completely inflated gzip members
+        bool first_member_only;         ///< stop at the end of the first gzip member
+        bool m_good;
+
+        GzipIndex *index;               ///< index to record, if any
+        DataLineCounter counter;        ///< data lines in front of the current position
+        uint64_t last_point;            ///< offset of the last recorded seek point
+
+        bool fill();
+        void record(const char *out, size_t n);
+
+    public:
+        GzipDecompressor(const std::string &filename, size_t chunk_size=1<<20);
+        ~GzipDecompressor();
+
+        void recordIndex(GzipIndex *index);
+
+        size_t read(char *buf, size_t n) override;
+        bool good() const override;
+};
+
+/** Inflates one segment of a gzip file, between two seek points of its
+ * GzipIndex.
+ *
+ * Exactly the lines starting inside of the segment are returned: a line
+ * crossing the start of the segment is dropped, a line crossing its end
+ * is completed.
+ *
+ * An index is only saved for files with a single gzip member, see
+ * GzipDecompressor::record(), so every segment ends at the end of the
+ * first member at the latest. The segments after the first one inflate
+ * raw deflate data, which must not continue into the gzip trailer.
+ */
+class GzipSegmentDecompressor : public GzipDecompressor
+{
+    protected:
+        uint64_t offset;      ///< uncompressed bytes inflated since the start of the segment
+        uint64_t length;      ///< uncompressed length of the segment
+        bool skip_partial;    ///< the segment starts inside of a line
+        bool done;
+
+    public:
+        GzipSegmentDecompressor(const std::string &filename, const GzipIndex &index, size_t k);
+
+        size_t read(char *buf, size_t n) override;
+};
+
+#ifdef HAVE_ZSTD
+/** Decompresses zstd files, also with several frames. Skippable frames,
+ * like the seek table of the seekable zstd format, are ignored.
+ */
+class ZstdDecompressor : public Decompressor
+{
+    protected:
+        int fd;
+        ZSTD_DStream *stream;
+        std::vector<char> in;           ///< buffer for the compressed data
+        ZSTD_inBuffer input;            ///< unconsumed part of in
+        bool input_done;                ///< end of the file reached
+        size_t hint;                    ///< 0, if the last frame is complete
+        bool m_good;
+
+        bool fill();
+
+    public:
+        ZstdDecompressor(const std::string &filename, size_t chunk_size=1<<20);
+        ~ZstdDecompressor();
+
+        size_t read(char *buf, size_t n) override;
+        bool good() const override;
+};
+#endif
+
+#ifdef HAVE_LZ4
+/** Decompresses lz4 frame files, also with several frames.
+ */
+class Lz4Decompressor : public Decompressor
+{
+    protected:
+        int fd;
+        LZ4F_dctx *dctx;
+        std::vector<char> in;           ///< buffer for the compressed data
+        size_t pos;                     ///< start of the unconsumed part of in
+        size_t len;                     ///< end of the valid data in in
+        bool input_done;                ///< end of the file reached
+        size_t hint;                    ///< 0, if the last frame is complete
+        bool m_good;
+
+        bool fill();
+
+    public:
+        Lz4Decompressor(const std::string &filename, size_t chunk_size=1<<20);
+        ~Lz4Decompressor();
+
+        size_t read(char *buf, size_t n) override;
+        bool good() const override;
+};
+#endif
+
+/** Decompresses another source in a background thread, ahead of the
+ * reader.
+ *
+ * While the caller evaluates a block, the next blocks are already
+ * decompressed (and their compressed data read with read ahead) and
+ * wait in a queue. The queue is bounded: if it is full, or all
+ * prefetched blocks of all instances together would exceed the
+ * memory limit, the background thread waits for the reader.
+ */
+class PrefetchDecompressor : public Decompressor
+{
+    protected:
+        std::unique_ptr<Decompressor> source;
+        size_t block_size;
+        size_t max_blocks;                  ///< maximum length of the queue
+
+        std::deque<std::vector<char>> queue;    ///< decompressed blocks, ready to read
+        std::vector<char> current;          ///< block the reader is at
+        size_t pos;                         ///< position of the reader in current
+        size_t blocks;                      ///< blocks counted against the memory limit, guarded by memory_mutex
+        bool source_done;                   ///< source is exhausted
+        bool source_good;                   ///< good() of the source, when it was exhausted
+        bool stop;                          ///< background thread should stop, guarded by memory_mutex
+        mutable std::mutex mutex;           ///< guards queue, source_done and source_good
+        std::condition_variable ready;
+        std::thread worker;
+
+        static size_t memory_limit;
+        static size_t memory_used;
+        static std::mutex memory_mutex;
+        static std::condition_variable memory_freed;
+
+        void produce();
+        void release(size_t n);
+
+    public:
+        PrefetchDecompressor(std::unique_ptr<Decompressor> source, size_t block_size=1<<22, size_t max_blocks=8);
+        ~PrefetchDecompressor();
+
+        size_t read(char *buf, size_t n) override;
+        bool good() const override;
+
+        static void setMemoryLimit(size_t bytes);
+        static std::unique_ptr<Decompressor> wrap(std::unique_ptr<Decompressor> source);
+};
+
+Compression detectCompression(const std::string &filename);
+bool canDecompress(const std::string &filename);
+std::string decompressCommand(const std::string &filename);
+std::unique_ptr<Decompressor> openDecompressor(const std::string &filename);
@@ -0,0 +1,230 @@
+#include "FileStatistics.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#include "Logging.hpp"
+
+/// identifies statistics files and their version
+static const char STATISTICS_MAGIC[8] = {'G', 'L', 'U', 'E', 'S', 'T', 'A', '1'};
+
+/// header of a statistics file, followed by the points and the columns
+struct StatisticsHeader
+{
+    char magic[8];
+    HistogramCache::Fingerprint source;     ///< only the identity of the source is used
+    int64_t span;
+    int64_t lines;
+    int32_t complete;
+    int32_t num_columns;
+    uint64_t num_points;
+};
+
+/// whether the range of the column is known
+bool FileStatistics::Column::hasRange() const
+{
+    return min <= max;
+}
+
+/** Empty statistics.
+ *
+ * \param span  number of data lines between the points of the index
+ */
+FileStatistics::FileStatistics(int64_t span)
+    : m_span(span),
+      m_lines(-1),
+      m_complete(false),
+      changed(false)
+{
+    std::memset(&identity, 0, sizeof(identity));
+}
+
+/// name of the statistics of source, next to it or in the cache directory
+std::string FileStatistics::fileName(const std::string &source)
+{
+    HistogramCache::Fingerprint none;
+    std::memset(&none, 0, sizeof(none));
+    return HistogramCache::fileName(source + ".stats", source, none);
+}
+
+/** Load the statistics of the source.
+ *
+ * The identity of the source is remembered, such that statistics
+ * gathered while reading it are only saved, if it did not change.
+ *
+ * \return false, if there are no statistics or if they do not match the source
+ */
+bool FileStatistics::load(const std::string &source)
+{
+    m_source = source;
+    identity = HistogramCache::fingerprint(source, 0, 0, 0, 0, 0, 0);
+
+    std::ifstream is(fileName(source), std::ios::binary);
+    StatisticsHeader header;
+    is.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if(!is.good() || std::memcmp(header.magic, STATISTICS_MAGIC, sizeof(STATISTICS_MAGIC)) != 0
+       || !header.source.sameSource(identity))
+        return false;
+
+    // check the counts against the size, before anything is allocated
+    is.seekg(0, std::ios::end);
+    const uint64_t size = is.tellg();
+    is.seekg(sizeof(header));
+    if(header.num_columns < 0 || header.num_points > size / sizeof(Point)
+       || size != sizeof(header) + header.num_points * sizeof(Point) + header.num_columns * sizeof(Column))
+    {
+        LOG(LOG_WARNING) << "corrupt statistics " << fileName(source);
+        return false;
+    }
+
+    std::vector<Point> points(header.num_points);
+    std::vector<Column> columns(header.num_columns);
+    is.read(reinterpret_cast<char*>(points.data()), points.size() * sizeof(Point));
+    is.read(reinterpret_cast<char*>(columns.data()), columns.size() * sizeof(Column));
+    if(!is.good())
+    {
+        LOG(LOG_WARNING) << "corrupt statistics " << fileName(source);
+        return false;
+    }
+
+    m_span = header.span;
+    m_lines = header.lines;
+    m_complete = header.complete;
+    m_points = std::move(points);
+    m_columns = std::move(columns);
+    changed = false;
+    return true;
+}
+
+/** Save the statistics, if anything was added since they were loaded.
+ *
+ * Nothing is saved, if the source changed since load(), e.g., while a
+ * simulation appends to it. Failing to write is not an error.
+ */
+void FileStatistics::save() const
+{
+    if(!changed || m_source.empty())
+        return;
+
+    StatisticsHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, STATISTICS_MAGIC, sizeof(STATISTICS_MAGIC));
+    header.source = HistogramCache::fingerprint(m_source, 0, 0, 0, 0, 0, 0);
+    if(!header.source.source_size || !header.source.sameSource(identity))
+    {
+        LOG(LOG_DEBUG) << m_source << " changed, do not save its statistics";
+        return;
+    }
+    header.span = m_span;
+    header.lines = m_lines;
+    header.complete = m_complete;
+    header.num_columns = m_columns.size();
+    header.num_points = m_points.size();
+
+    const std::string filename = fileName(m_source);
+    const std::string tmp = HistogramCache::temporaryName(filename);
+    std::ofstream os(tmp, std::ios::binary);
+    if(!os.good())
+    {
+        LOG(LOG_DEBUG) << "can not write " << filename;
+        return;
+    }
+
+    os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    os.write(reinterpret_cast<const char*>(m_points.data()), m_points.size() * sizeof(Point));
+    os.write(reinterpret_cast<const char*>(m_columns.data()), m_columns.size() * sizeof(Column));
+    os.close();
+    HistogramCache::replace(tmp, filename, os.good());
+}
+
+/// whether the index of the data lines is known
+bool FileStatistics::indexed() const
+{
+    return m_lines >= 0;
+}
+
+/// number of data lines between the points of the index
+int64_t FileStatistics::span() const
+{
+    return m_span;
+}
+
+/// number of data lines of the source, -1 if not indexed
+int64_t FileStatistics::lines() const
+{
+    return m_lines;
+}
+
+/** Whether the last data line of the source ends with a newline.
+ *
+ * Otherwise it may still be written, such that evaluations, which
+ * ignore it, may differ from evaluations, which use it.
+ */
+bool FileStatistics::complete() const
+{
+    return m_complete;
+}
+
+/** Point of the index in front of the given data line.
+ *
+ * \param line  number of data lines, which need not be read
+ * \return the last point with at most line data lines in front of it
+ */
+FileStatistics::Point FileStatistics::seek(int64_t line) const
+{
+    auto it = std::upper_bound(m_points.begin(), m_points.end(), line, [](int64_t l, const Point &p){ return l < p.lines; });
+    if(it == m_points.begin())
+        return Point{0, 0};
+    return *(it - 1);
+}
+
+/** Set the index of the data lines.
+ *
+ * \param points    seek points in the order of the file
+ * \param lines     number of data lines of the source
+ * \param complete  whether the last data line ends with a newline
+ */
+void FileStatistics::setIndex(std::vector<Point> points, int64_t lines, bool complete)
+{
+    m_points = std::move(points);
+    m_lines = lines;
+    m_complete = complete;
+    changed = true;
+}
+
+/// statistics of a column after skip, nullptr if unknown
+const FileStatistics::Column* FileStatistics::find(int column, int skip) const
+{
+    for(const auto &c : m_columns)
+        if(c.column == column && c.skip == skip)
+            return &c;
+    return nullptr;
+}
+
+/** Add statistics of a column.
+ *
+ * Statistics, which are unknown in stats, are kept from earlier
+ * evaluations of the same column and skip.
+ */
+void FileStatistics::update(const Column &stats)
+{
+    changed = true;
+    for(auto &known : m_columns)
+    {
+        if(known.column != stats.column || known.skip != stats.skip)
+            continue;
+
+        if(stats.hasRange())
+        {
+            known.min = stats.min;
+            known.max = stats.max;
+        }
+        if(stats.tau > 0)
+            known.tau = stats.tau;
+        if(stats.equilibration >= 0)
+            known.equilibration = stats.equilibration;
+        return;
+    }
+    m_columns.push_back(stats);
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+#include "HistogramCache.hpp"
+
+/** Statistics of a raw data file, saved next to it (or in the cache
+ * directory, see HistogramCache::setDirectory()) as a compact binary
+ * sidecar, such that later runs need not read the file to obtain them.
+ *
+ * The sidecar contains the number of data lines, a sparse index of the
+ * byte offsets of every span-th data line of uncompressed text files,
+ * and for every evaluated column and skip the range of the data, the
+ * estimated autocorrelation time and an estimate of the equilibration
+ * time. With the index, the lines discarded by skip are not parsed, but
+ * skipped by a seek. With the range, the borders of the histograms are
+ * known without reading the file.
+ *
+ * The statistics are only used, if the identity of the source (see
+ * HistogramCache::fingerprint()) did not change since they were saved.
+ */
+class FileStatistics
+{
+    public:
+        /// seek point at the start of a data line
+        struct Point
+        {
+            uint64_t offset;        ///< byte offset in the file
+            int64_t lines;          ///< number of data lines in front of offset
+        };
+
+        /// statistics of a column after skip
+        struct Column
+        {
+            int32_t column;
+            int32_t skip;
+            int64_t equilibration;  ///< estimated number of data lines to skip, -1 if unknown
+            double min;             ///< smallest value, larger than max if unknown
+            double max;             ///< largest value
+            double tau;             ///< estimated autocorrelation time, 0 if unknown or the step was given
+
+            bool hasRange() const;
+        };
+
+        FileStatistics(int64_t span=1<<14);
+
+        bool load(const std::string &source);
+        void save() const;
+
+        bool indexed() const;
+        int64_t span() const;
+        int64_t lines() const;
+        bool complete() const;
+        Point seek(int64_t line) const;
+        void setIndex(std::vector<Point> points, int64_t lines, bool complete);
+
+        const Column* find(int column, int skip) const;
+        void update(const Column &stats);
+
+        static std::string fileName(const std::string &source);
+
+    protected:
+        std::string m_source;
+        HistogramCache::Fingerprint identity;   ///< of the source, when loaded
+        int64_t m_span;             ///< number of data lines between the points
+        int64_t m_lines;            ///< number of data lines, -1 if not indexed
+        bool m_complete;            ///< whether the last data line ends with a newline
+        std::vector<Point> m_points;
+        std::vector<Column> m_columns;
+        bool changed;               ///< whether anything needs to be saved
+};
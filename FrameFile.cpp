@@ -0,0 +1,218 @@
+#include "FrameFile.hpp"
+
+/// little endian integer of n bytes at p
+static uint64_t readLE(const char *p, int n)
+{
+    uint64_t x = 0;
+    for(int i=n-1; i>=0; --i)
+        x = (x << 8) | static_cast<unsigned char>(p[i]);
+    return x;
+}
+
+/// whether a skippable frame (zstd and lz4) starts at p
+static bool isSkippable(const char *p)
+{
+    return (readLE(p, 4) & 0xFFFFFFF0) == 0x184D2A50;
+}
+
+/** Locate the frames of the given file.
+ *
+ * If not all frames can be located or their decompressed size is not
+ * known, good() is false and the file needs to be read serially.
+ */
+FrameFile::FrameFile(const std::string &filename)
+    : file(filename),
+      format(detectCompression(filename)),
+      m_good(false)
+{
+    if(!file.good())
+        return;
+
+    #ifdef HAVE_ZSTD
+    if(format == Compression::Zstd)
+        m_good = scanSeekTable() || scanZstd();
+    #endif
+    #ifdef HAVE_LZ4
+    if(format == Compression::Lz4)
+        m_good = scanLz4();
+    #endif
+
+    if(!m_good)
+        m_frames.clear();
+}
+
+/// whether all frames are known and can be decoded with decode()
+bool FrameFile::good() const
+{
+    return m_good;
+}
+
+/// all frames with content, in the order of the file
+const std::vector<FrameFile::Frame>& FrameFile::frames() const
+{
+    return m_frames;
+}
+
+/** Use the seek table of the seekable zstd format.
+ *
+ * The table is a skippable frame at the end of the file, which lists the
+ * compressed and decompressed size of every frame.
+ */
+bool FrameFile::scanSeekTable()
+{
+    const std::string_view all = file.view();
+    const size_t footer = 9;
+    if(all.size() < 8 + footer || readLE(all.data() + all.size() - 4, 4) != 0x8F92EAB1)
+        return false;
+
+    const uint64_t num_frames = readLE(all.data() + all.size() - footer, 4);
+    const int descriptor = static_cast<unsigned char>(all[all.size() - 5]);
+    const size_t entry = descriptor & 0x80 ? 12 : 8;
+    const uint64_t table = 8 + num_frames * entry + footer;
+    if(table > all.size())
+        return false;
+
+    const char *p = all.data() + all.size() - table;
+    if(readLE(p, 4) != 0x184D2A5E)
+        return false;
+
+    size_t offset = 0;
+    p += 8;
+    for(uint64_t k=0; k<num_frames; ++k, p+=entry)
+    {
+        Frame f;
+        f.offset = offset;
+        f.size = readLE(p, 4);
+        f.content_size = readLE(p + 4, 4);
+        offset += f.size;
+        if(f.content_size)
+            m_frames.push_back(f);
+    }
+
+    return offset == all.size() - table;
+}
+
+/// walk the frame headers of a zstd file
+bool FrameFile::scanZstd()
+{
+    #ifdef HAVE_ZSTD
+    const std::string_view all = file.view();
+    m_frames.clear();
+    for(size_t offset = 0; offset < all.size(); )
+    {
+        const char *p = all.data() + offset;
+        const size_t size = ZSTD_findFrameCompressedSize(p, all.size() - offset);
+        if(ZSTD_isError(size))
+            return false;
+
+        if(!isSkippable(p))
+        {
+            const unsigned long long content_size = ZSTD_getFrameContentSize(p, size);
+            if(content_size == ZSTD_CONTENTSIZE_UNKNOWN || content_size == ZSTD_CONTENTSIZE_ERROR)
+                return false;
+            if(content_size)
+                m_frames.push_back({offset, size, static_cast<size_t>(content_size)});
+        }
+        offset += size;
+    }
+    return true;
+    #else
+    return false;
+    #endif
+}
+
+/// walk the frame and block headers of a lz4 file
+bool FrameFile::scanLz4()
+{
+    const std::string_view all = file.view();
+    const char *data = all.data();
+    const size_t n = all.size();
+    for(size_t offset = 0; offset < n; )
+    {
+        if(n - offset < 8)
+            return false;
+
+        if(isSkippable(data + offset))
+        {
+            offset += 8 + readLE(data + offset + 4, 4);
+            continue;
+        }
+        if(readLE(data + offset, 4) != 0x184D2204)
+            return false;
+
+        // frame descriptor: FLG, BD, content size, dictionary id, checksum
+        const int flags = static_cast<unsigned char>(data[offset + 4]);
+        if(!(flags & 0x08))
+            return false;
+        const size_t content_size = readLE(data + offset + 6, 8);
+        size_t pos = offset + 6 + 8 + (flags & 0x01 ? 4 : 0) + 1;
+
+        // blocks, terminated by a zero size
+        for(;;)
+        {
+            if(pos + 4 > n)
+                return false;
+            const uint64_t block = readLE(data + pos, 4);
+            pos += 4;
+            if(!block)
+                break;
+            pos += (block & 0x7FFFFFFF) + (flags & 0x10 ? 4 : 0);
+        }
+        pos += flags & 0x04 ? 4 : 0;
+        if(pos > n)
+            return false;
+
+        if(content_size)
+            m_frames.push_back({offset, pos - offset, content_size});
+        offset = pos;
+    }
+    return true;
+}
+
+/** Decode a frame into dst, which needs room for its content_size bytes.
+ *
+ * Can be called from several threads at once.
+ *
+ * \return false, if the frame is corrupt
+ */
+bool FrameFile::decode(const Frame &frame, char *dst) const
+{
+    const char *src = file.view().data() + frame.offset;
+
+    #ifdef HAVE_ZSTD
+    if(format == Compression::Zstd)
+    {
+        const size_t r = ZSTD_decompress(dst, frame.content_size, src, frame.size);
+        return !ZSTD_isError(r) && r == frame.content_size;
+    }
+    #endif
+
+    #ifdef HAVE_LZ4
+    if(format == Compression::Lz4)
+    {
+        LZ4F_dctx *dctx;
+        if(LZ4F_isError(LZ4F_createDecompressionContext(&dctx, LZ4F_VERSION)))
+            return false;
+
+        size_t in = 0;
+        size_t out = 0;
+        size_t hint = 1;
+        while(hint && in < frame.size)
+        {
+            size_t in_size = frame.size - in;
+            size_t out_size = frame.content_size - out;
+            hint = LZ4F_decompress(dctx, dst + out, &out_size, src + in, &in_size, nullptr);
+            if(LZ4F_isError(hint) || (!in_size && !out_size))
+                break;
+            in += in_size;
+            out += out_size;
+        }
+        LZ4F_freeDecompressionContext(dctx);
+        return !hint && out == frame.content_size;
+    }
+    #endif
+
+    (void) src;
+    (void) dst;
+    return false;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "Decompressor.hpp"
+#include "MappedFile.hpp"
+
+/** The independent frames of a zstd or lz4 file, which can be decoded
+ * in parallel.
+ *
+ * The file is memory mapped and the frames are located without
+ * decompressing them. For the seekable zstd format the seek table at the
+ * end of the file is used, otherwise the frame headers are walked.
+ *
+ * Every frame is decoded directly into its place in a buffer, hence the
+ * decompressed size of every frame needs to be known, either from the
+ * seek table or from the frame header (e.g., `lz4 --content-size`).
+ */
+class FrameFile
+{
+    public:
+        /// one frame of compressed data
+        struct Frame
+        {
+            size_t offset;          ///< offset in the file
+            size_t size;            ///< compressed size
+            size_t content_size;    ///< decompressed size
+        };
+
+        FrameFile(const std::string &filename);
+
+        bool good() const;
+        const std::vector<Frame>& frames() const;
+        bool decode(const Frame &frame, char *dst) const;
+
+    protected:
+        MappedFile file;
+        Compression format;
+        std::vector<Frame> m_frames;
+        bool m_good;                ///< all frames found and their sizes known
+
+        bool scanSeekTable();
+        bool scanZstd();
+        bool scanLz4();
+};
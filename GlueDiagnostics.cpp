@@ -0,0 +1,39 @@
+#include "GlueDiagnostics.hpp"
+
+FileDiagnostics::FileDiagnostics(const GnuplotData &gp)
+    : osHist(gp.hist_name),
+      osCorrected(gp.corrected_name),
+      osGlued(gp.glued_name),
+      osFinished(gp.finished_name)
+{
+}
+
+/// write the finite values of a window of bins as a block of "center value" lines
+void FileDiagnostics::write(std::ofstream &os, const std::vector<double> &centers, int first, const std::vector<double> &values)
+{
+    for(size_t k=0; k<values.size(); ++k)
+        if(std::isfinite(values[k]))
+            os << centers[first + k] << " " << values[k] << "\n";
+    os << "\n";
+}
+
+void FileDiagnostics::histograms(const std::vector<Histogram> &hists)
+{
+    for(auto &h : hists)
+        osHist << h.ascii_table() << "\n";
+}
+
+void FileDiagnostics::corrected(const std::vector<double> &centers, int first, const std::vector<double> &values)
+{
+    write(osCorrected, centers, first, values);
+}
+
+void FileDiagnostics::glued(const std::vector<double> &centers, int first, const std::vector<double> &values)
+{
+    write(osGlued, centers, first, values);
+}
+
+void FileDiagnostics::finished(const Histogram &out)
+{
+    osFinished << out.ascii_table();
+}
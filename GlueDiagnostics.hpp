@@ -0,0 +1,65 @@
+#pragma once
+
+#include <vector>
+#include <fstream>
+
+#include "Histogram.hpp"
+#include "gnuplot.hpp"
+
+/** Receives the intermediate results of glueHistograms(), e.g., to plot
+ * the quality of the glueing.
+ *
+ * The corrected and glued data of a histogram are passed as the values
+ * of its stored window of bins, starting at bin first. Values outside
+ * of the window are never finite.
+ */
+class GlueDiagnostics
+{
+    public:
+        virtual ~GlueDiagnostics() = default;
+
+        /// the input histograms
+        virtual void histograms(const std::vector<Histogram> &hists) = 0;
+        /// corrected data of one histogram, before shifting by Z
+        virtual void corrected(const std::vector<double> &centers, int first, const std::vector<double> &values) = 0;
+        /// corrected data of one histogram, shifted by Z
+        virtual void glued(const std::vector<double> &centers, int first, const std::vector<double> &values) = 0;
+        /// the glued and normalized result
+        virtual void finished(const Histogram &out) = 0;
+};
+
+/** Discards all diagnostics, e.g., of bootstrap replicas, such that
+ * glueing needs no I/O at all.
+ */
+class NullDiagnostics : public GlueDiagnostics
+{
+    public:
+        void histograms(const std::vector<Histogram> &) override {}
+        void corrected(const std::vector<double> &, int, const std::vector<double> &) override {}
+        void glued(const std::vector<double> &, int, const std::vector<double> &) override {}
+        void finished(const Histogram &) override {}
+};
+
+/** Writes the diagnostics into the files named by GnuplotData, which are
+ * plotted by write_gnuplot_quality().
+ *
+ * All files are truncated on construction.
+ */
+class FileDiagnostics : public GlueDiagnostics
+{
+    protected:
+        std::ofstream osHist;
+        std::ofstream osCorrected;
+        std::ofstream osGlued;
+        std::ofstream osFinished;
+
+        static void write(std::ofstream &os, const std::vector<double> &centers, int first, const std::vector<double> &values);
+
+    public:
+        FileDiagnostics(const GnuplotData &gp);
+
+        void histograms(const std::vector<Histogram> &hists) override;
+        void corrected(const std::vector<double> &centers, int first, const std::vector<double> &values) override;
+        void glued(const std::vector<double> &centers, int first, const std::vector<double> &values) override;
+        void finished(const Histogram &out) override;
+};
@@ -0,0 +1,275 @@
+#include "GzipIndex.hpp"
+
+#include <cstring>
+#include <fstream>
+
+#include <sys/stat.h>
+#include <zlib.h>
+
+#include "HistogramCache.hpp"
+#include "Logging.hpp"
+
+/// identifies index files and their version
+static const char INDEX_MAGIC[8] = {'G', 'L', 'U', 'E', 'G', 'Z', 'I', '1'};
+
+/// header of an index file, the source is identified by size and mtime
+struct IndexHeader
+{
+    char magic[8];
+    uint64_t source_size;
+    int64_t source_mtime;
+    uint64_t span;
+    uint64_t num_points;
+};
+
+/// fill size and mtime of the given file, false if it does not exist
+static bool sourceIdentity(const std::string &filename, uint64_t &size, int64_t &mtime)
+{
+    struct stat st;
+    if(stat(filename.c_str(), &st) != 0)
+        return false;
+    size = st.st_size;
+    mtime = st.st_mtime;
+    return true;
+}
+
+/// read the header of the index of filename, false if it does not belong to filename
+static bool readHeader(std::ifstream &is, const std::string &filename, IndexHeader &header)
+{
+    uint64_t size;
+    int64_t mtime;
+    if(!is.read(reinterpret_cast<char*>(&header), sizeof(header)))
+        return false;
+    if(std::memcmp(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0)
+        return false;
+    if(!sourceIdentity(filename, size, mtime))
+        return false;
+    return header.source_size == size && header.source_mtime == mtime;
+}
+
+DataLineCounter::DataLineCounter()
+    : at_line_start(true),
+      m_lines(0)
+{
+}
+
+/// count the lines starting in the next chunk of text
+void DataLineCounter::scan(const char *text, size_t n)
+{
+    const char *end = text + n;
+    while(text != end)
+    {
+        if(at_line_start && *text != '\n' && *text != '#')
+            ++m_lines;
+
+        const char *nl = static_cast<const char*>(std::memchr(text, '\n', end - text));
+        at_line_start = nl;
+        if(!nl)
+            break;
+        text = nl + 1;
+    }
+}
+
+/// whether the next byte starts a new line
+bool DataLineCounter::lineStart() const
+{
+    return at_line_start;
+}
+
+/// number of data lines started so far
+int64_t DataLineCounter::lines() const
+{
+    return m_lines;
+}
+
+/** Create an empty index.
+ *
+ * \param span  minimal distance of the points in the uncompressed data
+ */
+GzipIndex::GzipIndex(uint64_t span)
+    : m_span(span),
+      complete(true)
+{
+}
+
+/** Add a seek point, the window is stored compressed.
+ *
+ * \param out           offset in the uncompressed data
+ * \param in            offset in the compressed file
+ * \param bits          unused bits in the last byte before in
+ * \param counter       counter of the data lines in front of out
+ * \param window        the (up to) 32 KiB uncompressed data in front of out
+ * \param window_size   size of the window
+ */
+void GzipIndex::addPoint(uint64_t out, uint64_t in, int bits, const DataLineCounter &counter, const unsigned char *window, uint32_t window_size)
+{
+    Point p;
+    p.out = out;
+    p.in = in;
+    p.bits = bits;
+    p.line_start = counter.lineStart();
+    p.lines = counter.lines();
+    p.window_size = window_size;
+
+    uLongf len = compressBound(window_size);
+    p.window.resize(len);
+    compress2(p.window.data(), &len, window, window_size, 1);
+    p.window.resize(len);
+
+    m_points.push_back(std::move(p));
+}
+
+/// mark the index as not usable, e.g., because the file has several gzip members
+void GzipIndex::setIncomplete()
+{
+    complete = false;
+}
+
+/// whether the index can be used to read the file in parallel
+bool GzipIndex::usable() const
+{
+    return complete && !m_points.empty();
+}
+
+/// minimal distance of the points in the uncompressed data
+uint64_t GzipIndex::span() const
+{
+    return m_span;
+}
+
+/// all seek points, ordered by their offset
+const std::vector<GzipIndex::Point>& GzipIndex::points() const
+{
+    return m_points;
+}
+
+/// uncompressed window of the k-th point
+std::vector<unsigned char> GzipIndex::window(size_t k) const
+{
+    const Point &p = m_points[k];
+    std::vector<unsigned char> w(p.window_size);
+    uLongf len = p.window_size;
+    uncompress(w.data(), &len, p.window.data(), p.window.size());
+    return w;
+}
+
+/// name of the index of the given data file, next to it or in the cache directory
+std::string GzipIndex::indexName(const std::string &filename)
+{
+    HistogramCache::Fingerprint none;
+    std::memset(&none, 0, sizeof(none));
+    return HistogramCache::fileName(filename + ".gzidx", filename, none);
+}
+
+/** Whether there is an index for the data file, which is up to date.
+ *
+ * Only the header is read.
+ */
+bool GzipIndex::available(const std::string &filename)
+{
+    std::ifstream is(indexName(filename), std::ios::binary);
+    IndexHeader header;
+    return is.good() && readHeader(is, filename, header);
+}
+
+/** Load the index of the given data file.
+ *
+ * \return false, if there is no index or if it does not match the data file
+ */
+bool GzipIndex::load(const std::string &filename)
+{
+    std::ifstream is(indexName(filename), std::ios::binary);
+    IndexHeader header;
+    if(!is.good() || !readHeader(is, filename, header))
+        return false;
+
+    // the points need at least their fields of fixed size, the sizes read
+    // from the file are checked against it before anything is allocated
+    const uint64_t point_size = 2*sizeof(uint64_t) + 2*sizeof(int32_t) + sizeof(int64_t) + 2*sizeof(uint32_t);
+    uint64_t size;
+    int64_t mtime;
+    bool corrupt = !sourceIdentity(indexName(filename), size, mtime)
+                   || header.num_points > (size - sizeof(header)) / point_size;
+    uint64_t windows_size = corrupt ? 0 : size - sizeof(header) - header.num_points * point_size;
+
+    m_span = header.span;
+    m_points.resize(corrupt ? 0 : header.num_points);
+    for(auto &p : m_points)
+    {
+        int32_t bits, line_start;
+        uint32_t compressed_size;
+        is.read(reinterpret_cast<char*>(&p.out), sizeof(p.out));
+        is.read(reinterpret_cast<char*>(&p.in), sizeof(p.in));
+        is.read(reinterpret_cast<char*>(&bits), sizeof(bits));
+        is.read(reinterpret_cast<char*>(&line_start), sizeof(line_start));
+        is.read(reinterpret_cast<char*>(&p.lines), sizeof(p.lines));
+        is.read(reinterpret_cast<char*>(&p.window_size), sizeof(p.window_size));
+        is.read(reinterpret_cast<char*>(&compressed_size), sizeof(compressed_size));
+        // the window of deflate is at most 32 KiB
+        if(!is.good() || compressed_size > windows_size || p.window_size > 32768)
+        {
+            corrupt = true;
+            break;
+        }
+        windows_size -= compressed_size;
+        p.bits = bits;
+        p.line_start = line_start;
+        p.window.resize(compressed_size);
+        is.read(reinterpret_cast<char*>(p.window.data()), compressed_size);
+    }
+
+    if(corrupt || !is.good())
+    {
+        LOG(LOG_WARNING) << "corrupt index " << indexName(filename);
+        m_points.clear();
+        return false;
+    }
+
+    complete = true;
+    return true;
+}
+
+/** Save the index next to the data file.
+ *
+ * Unusable indices are not saved, failing to write is not an error.
+ */
+void GzipIndex::save(const std::string &filename) const
+{
+    if(!usable())
+        return;
+
+    IndexHeader header;
+    std::memcpy(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    if(!sourceIdentity(filename, header.source_size, header.source_mtime))
+        return;
+    header.span = m_span;
+    header.num_points = m_points.size();
+
+    const std::string name = indexName(filename);
+    const std::string tmp = HistogramCache::temporaryName(name);
+    std::ofstream os(tmp, std::ios::binary);
+    if(!os.good())
+    {
+        LOG(LOG_DEBUG) << "can not write " << name;
+        return;
+    }
+
+    os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for(const auto &p : m_points)
+    {
+        int32_t bits = p.bits;
+        int32_t line_start = p.line_start;
+        uint32_t compressed_size = p.window.size();
+        os.write(reinterpret_cast<const char*>(&p.out), sizeof(p.out));
+        os.write(reinterpret_cast<const char*>(&p.in), sizeof(p.in));
+        os.write(reinterpret_cast<const char*>(&bits), sizeof(bits));
+        os.write(reinterpret_cast<const char*>(&line_start), sizeof(line_start));
+        os.write(reinterpret_cast<const char*>(&p.lines), sizeof(p.lines));
+        os.write(reinterpret_cast<const char*>(&p.window_size), sizeof(p.window_size));
+        os.write(reinterpret_cast<const char*>(&compressed_size), sizeof(compressed_size));
+        os.write(reinterpret_cast<const char*>(p.window.data()), compressed_size);
+    }
+    os.close();
+    HistogramCache::replace(tmp, name, os.good());
+    LOG(LOG_DEBUG) << "saved index with " << m_points.size() << " points to " << name;
+}
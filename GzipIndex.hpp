@@ -0,0 +1,73 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+/** Counts the data lines (neither empty nor comments) of a stream of
+ * text, which is passed in arbitrary chunks.
+ */
+class DataLineCounter
+{
+    protected:
+        bool at_line_start;   ///< whether the next byte starts a line
+        int64_t m_lines;      ///< data lines started so far
+
+    public:
+        DataLineCounter();
+
+        void scan(const char *text, size_t n);
+
+        bool lineStart() const;
+        int64_t lines() const;
+};
+
+/** Index of seek points into a gzip file, which allow to start inflating
+ * in the middle of the file (like zran.c of the zlib examples).
+ *
+ * Every point stores the 32 KiB of uncompressed data in front of it, the
+ * window, which is needed to resume inflating there. It also stores the
+ * number of data lines in front of it, such that the segments between
+ * the points can be evaluated in parallel, applying skip and step exactly.
+ *
+ * The index is built while the file is read anyway, by a
+ * GzipDecompressor, and saved next to the file (or in the cache
+ * directory, see HistogramCache::setDirectory()), such that later runs
+ * can use it.
+ */
+class GzipIndex
+{
+    public:
+        /// seek point at a deflate block boundary
+        struct Point
+        {
+            uint64_t out;       ///< offset in the uncompressed data
+            uint64_t in;        ///< offset of the first full byte in the file
+            int bits;           ///< number of bits of the preceding byte belonging to the block
+            bool line_start;    ///< whether a line starts at out
+            int64_t lines;      ///< number of data lines starting before out
+            uint32_t window_size;               ///< uncompressed size of the window
+            std::vector<unsigned char> window;  ///< window, compressed with zlib
+        };
+
+        GzipIndex(uint64_t span=1<<23);
+
+        void addPoint(uint64_t out, uint64_t in, int bits, const DataLineCounter &counter, const unsigned char *window, uint32_t window_size);
+        void setIncomplete();
+
+        bool usable() const;
+        uint64_t span() const;
+        const std::vector<Point>& points() const;
+        std::vector<unsigned char> window(size_t k) const;
+
+        bool load(const std::string &filename);
+        void save(const std::string &filename) const;
+
+        static std::string indexName(const std::string &filename);
+        static bool available(const std::string &filename);
+
+    protected:
+        uint64_t m_span;            ///< distance of the points in the uncompressed data
+        bool complete;              ///< false, if points are missing (e.g. multiple gzip members)
+        std::vector<Point> m_points;
+};
@@ -1,53 +1,81 @@
 #include "Histogram.hpp"
+#include "fileOp.hpp"
+#include "HistogramCache.hpp"
+#include "stat.hpp"
 
-Histogram::Histogram()
-    : num_bins(0),
-      m_cur_min(0),
-      m_total(0),
-      m_sum(0),
-      above(0),
-      below(0)
+#include <cstdint>
+
+/// append all space separated numbers of a line to a vector
+static void readWords(std::string_view line, std::vector<double> &v)
+{
+    size_t begin = 0;
+    while(begin < line.size())
+    {
+        size_t end = line.find(' ', begin);
+        if(end == std::string_view::npos)
+            end = line.size();
+        if(end > begin)
+            v.push_back(toDouble(line.substr(begin, end - begin)));
+        begin = end + 1;
+    }
+}
+
+/// layout of default constructed histograms without bins
+static const std::shared_ptr<const BinLayout>& noBins()
 {
+    static const std::shared_ptr<const BinLayout> none = std::make_shared<const BinLayout>(std::vector<double>());
+    return none;
 }
 
-Histogram::Histogram(const int num_bins, const double lower, const double upper)
-    : num_bins(num_bins),
-      lower(lower),
-      upper(upper),
-      m_cur_min(0),
+template<class Count>
+BasicHistogram<Count>::BasicHistogram()
+    : num_bins(0),
+      lower(0),
+      upper(0),
       m_total(0),
       m_sum(0),
       above(0),
       below(0),
-      data(num_bins, 0)
+      m_layout(noBins()),
+      m_first(0)
 {
-    double binwidth = (upper - lower) / num_bins;
-    bins.reserve(num_bins);
-    for(int i=0; i<num_bins; ++i)
-        bins.emplace_back(lower + i*binwidth);
-    bins.emplace_back(upper);
 }
 
-Histogram::Histogram(const std::vector<double> bins)
-    : num_bins(bins.size()-1),
-      lower(bins.front()),
-      upper(bins.back()),
-      m_cur_min(0),
+/// equidistant bins, sharing their layout with all histograms of the same binning
+template<class Count>
+BasicHistogram<Count>::BasicHistogram(const int num_bins, const double lower, const double upper)
+    : BasicHistogram(BinLayout::equidistantLayout(num_bins, lower, upper))
+{
+}
+
+template<class Count>
+BasicHistogram<Count>::BasicHistogram(const std::vector<double> bins)
+    : BasicHistogram(std::make_shared<const BinLayout>(bins))
+{
+}
+
+/// empty histogram with the bins of the given layout
+template<class Count>
+BasicHistogram<Count>::BasicHistogram(std::shared_ptr<const BinLayout> layout)
+    : num_bins(layout->num_bins()),
+      lower(layout->lower()),
+      upper(layout->upper()),
       m_total(0),
       m_sum(0),
       above(0),
       below(0),
-      bins(bins),
-      data(num_bins, 0)
+      m_layout(std::move(layout)),
+      m_first(0)
 {
 }
 
-Histogram::Histogram(const std::string filename)
-    : m_cur_min(0),
-      m_total(0),
+template<class Count>
+BasicHistogram<Count>::BasicHistogram(const std::string filename)
+    : m_total(0),
       m_sum(0),
       above(0),
-      below(0)
+      below(0),
+      m_first(0)
 {
     readFromFile(filename);
 }
@@ -57,7 +85,8 @@ Histogram::Histogram(const std::string filename)
  * \param where A value for which the corresponding bin is updated
  * \param what  The value by which the bin should be updated (default 1)
  */
-void Histogram::add(double where, double what)
+template<class Count>
+void BasicHistogram<Count>::add(double where, double what)
 {
     if(where >= upper)
     {
@@ -70,62 +99,216 @@ void Histogram::add(double where, double what)
         return;
     }
 
-    int idx = std::upper_bound(bins.begin(), bins.end(), where) - bins.begin();
-    --idx;
-
-    double tmp = data[idx];
-    data[idx] += what;
+    bin(m_layout->index(where)) += what;
     ++m_total;
     m_sum += what;
+}
+
+/// count of bin idx, the stored window is extended to it, if necessary
+template<class Count>
+Count& BasicHistogram<Count>::bin(int idx)
+{
+    if(idx < m_first || idx >= m_first + static_cast<int>(data.size()))
+        grow(idx);
+    return data[idx - m_first];
+}
+
+/** Extend the stored window of bins to contain idx.
+ *
+ * The window grows by at least its current size, such that filling
+ * the bins one after another stays linear.
+ */
+template<class Count>
+void BasicHistogram<Count>::grow(int idx)
+{
+    const int slack = std::max<int>(data.size(), 1024);
+    int begin = m_first;
+    int end = m_first + data.size();
+    if(data.empty())
+    {
+        begin = std::max(0, idx - slack/2);
+        end = std::min(num_bins, idx + slack/2 + 1);
+    }
+    else if(idx < begin)
+        begin = std::max(0, std::min(idx, begin - slack));
+    else
+        end = std::min(num_bins, std::max(idx + 1, end + slack));
+
+    std::vector<Count> window(end - begin, 0);
+    std::copy(data.begin(), data.end(), window.begin() + (m_first - begin));
+    data.swap(window);
+    m_first = begin;
+}
+
+/** Adds one entry for every value in [begin, end).
+ *
+ * Gives the same result as add() for every single value. Large batches
+ * are counted in several interleaved sub-counts, such that consecutive
+ * hits of the same bin do not wait for each other, which are folded
+ * into the bins at the end.
+ */
+template<class Count>
+void BasicHistogram<Count>::add(const double *begin, const double *end)
+{
+    const int block = 256;
+    const int lanes = 4;
+    const size_t n = end - begin;
+    const int slots_per_lane = num_bins + 2;
+    // with many bins, the same bin is rarely hit twice in a row and the
+    // sub-counts would not fit into the cache anymore
+    const bool interleave = slots_per_lane <= 4096 && n >= static_cast<size_t>(lanes * slots_per_lane);
+
+    std::vector<uint64_t> sub(interleave ? lanes * slots_per_lane : 0, 0);
+    int idx[block];
+    for(size_t pos=0; pos<n; pos+=block)
+    {
+        const int m = std::min<size_t>(block, n - pos);
+        m_layout->slots(begin + pos, m, idx);
+        if(interleave)
+        {
+            for(int k=0; k<m; ++k)
+                ++sub[idx[k] * lanes + (k & (lanes-1))];
+            continue;
+        }
 
-    // see if this is the current minimum and update, if necessary
-    if(tmp == m_cur_min)
+        for(int k=0; k<m; ++k)
+        {
+            if(idx[k] < num_bins)
+            {
+                bin(idx[k]) += 1;
+                ++m_total;
+                ++m_sum;
+            }
+            else if(idx[k] == num_bins)
+                below += 1;
+            else
+                above += 1;
+        }
+    }
+
+    if(!interleave)
+        return;
+
+    std::vector<uint64_t> counts(slots_per_lane, 0);
+    for(int i=0; i<slots_per_lane; ++i)
+        for(int l=0; l<lanes; ++l)
+            counts[i] += sub[i*lanes + l];
+
+    for(int i=0; i<num_bins; ++i)
     {
-        m_cur_min += what;
-        for(int i=0; i<num_bins; ++i)
-            if(data[i] < m_cur_min)
-                m_cur_min = data[i];
+        if(!counts[i])
+            continue;
+        bin(i) += counts[i];
+        m_total += counts[i];
+        m_sum += counts[i];
     }
+    below += counts[num_bins];
+    above += counts[num_bins + 1];
 }
 
-/// minimum value of all bins
-int Histogram::get_num_bins() const
+/** Add the bins first to last (exclusive) of another histogram with
+ * arbitrary borders.
+ *
+ * Every source bin is distributed onto the bins it overlaps,
+ * proportionally to the overlap, parts outside of the borders are
+ * counted as below or above. Since both borders are sorted, they are
+ * merged in a single pass.
+ */
+template<class Count>
+void BasicHistogram<Count>::rebin(const BasicHistogram &source, int first, int last)
+{
+    const std::vector<double> &src = source.borders();
+    const std::vector<double> &dst = borders();
+
+    int t = 0;
+    for(int s=first; s<last; ++s)
+    {
+        const double lo = src[s];
+        const double hi = src[s+1];
+        const double width = hi - lo;
+        const double value = source.at(s);
+
+        // a bin without width can not be split
+        if(width <= 0)
+        {
+            add(lo, value);
+            continue;
+        }
+
+        if(lo < lower)
+            below += value * (std::min(hi, lower) - lo) / width;
+        if(hi > upper)
+            above += value * (hi - std::max(lo, upper)) / width;
+        if(hi <= lower || lo >= upper)
+            continue;
+
+        while(t < num_bins && dst[t+1] <= lo)
+            ++t;
+
+        double inside = 0;
+        for(int k=t; k<num_bins && dst[k] < hi; ++k)
+        {
+            const double overlap = std::min(hi, dst[k+1]) - std::max(lo, dst[k]);
+            const double part = value * overlap / width;
+            bin(k) += part;
+            inside += part;
+        }
+        ++m_total;
+        m_sum += inside;
+    }
+}
+
+template<class Count>
+int BasicHistogram<Count>::get_num_bins() const
 {
     return num_bins;
 }
 
-/// minimum value of all bins
-int Histogram::min() const
+/** minimum value of all bins
+ *
+ * It is not tracked while adding entries, but searched on every call.
+ */
+template<class Count>
+Count BasicHistogram<Count>::min() const
 {
-    return m_cur_min;
+    Count m = data.empty() ? 0 : *std::min_element(data.begin(), data.end());
+    // bins outside of the window are empty
+    if(static_cast<int>(data.size()) < num_bins)
+        m = std::min<Count>(m, 0);
+    return m;
 }
 
 /// mean value of all bins
-double Histogram::mean() const
+template<class Count>
+double BasicHistogram<Count>::mean() const
 {
     return (double) m_sum / num_bins;
 }
 
 /// number of insertions into the histogram
-int Histogram::count() const
+template<class Count>
+int64_t BasicHistogram<Count>::count() const
 {
     return m_total;
 }
 
 /// sum of all bins (equal to count, for standard histograms)
-int Histogram::sum() const
+template<class Count>
+int64_t BasicHistogram<Count>::sum() const
 {
     return m_sum;
 }
 
 /// sets all entries to zero and clears statistical data
-void Histogram::reset()
+template<class Count>
+void BasicHistogram<Count>::reset()
 {
-    m_cur_min = 0;
     m_total = 0;
     m_sum = 0;
-    for(int i=0; i<num_bins; ++i)
-        data[i] = 0;
+    above = 0;
+    below = 0;
+    m_first = 0;
+    std::vector<Count>().swap(data);
 }
 
 /** trim the histogram
@@ -133,19 +316,20 @@ void Histogram::reset()
  * discard all bins left of the smallest without entries
  * and all bins right of the largest without entries
  */
-void Histogram::trim()
+template<class Count>
+void BasicHistogram<Count>::trim()
 {
     int left=0;
     int right=num_bins;
 
     int i=0;
-    while(data[i] == 0)
+    while(i < num_bins && at(i) == 0)
     {
         ++i;
         left = i;
     }
     for(; i<num_bins; ++i)
-        if(data[i] == 0)
+        if(at(i) == 0)
         {
             right = i;
             break;
@@ -156,86 +340,181 @@ void Histogram::trim()
         LOG(LOG_ERROR) << "The Histogram is empty after trimming!";
     }
 
+    const std::vector<double> &bins = borders();
     lower = bins[left];
     upper = bins[right];
     num_bins = right-left;
 
-    std::vector<double> new_bins(num_bins+1);
-    std::vector<double> new_data(num_bins);
-    for(int i=left, j=0; i<=right; ++i, ++j)
-        new_bins[j] = bins[i];
-
-    // minimum needs to be updated
-    m_cur_min = data[left+1];
+    std::vector<Count> new_data(num_bins);
     for(int i=left, j=0; i<right; ++i, ++j)
-    {
-        new_data[j] = data[i];
-        if(data[i] < m_cur_min)
-            m_cur_min = data[i];
-    }
+        new_data[j] = at(i);
 
-    bins = new_bins;
+    m_layout = std::make_shared<const BinLayout>(std::vector<double>(bins.begin() + left, bins.begin() + right + 1));
+    m_first = 0;
     data = new_data;
 }
 
-double Histogram::operator[](const double value) const
+template<class Count>
+Count BasicHistogram<Count>::operator[](const double value) const
 {
-    return operator[](value);
+    if(value >= upper)
+        return above;
+    if(value < lower)
+        return below;
+    return at(m_layout->index(value));
 }
 
-double& Histogram::operator[](const double value)
+template<class Count>
+Count& BasicHistogram<Count>::operator[](const double value)
 {
     if(value >= upper)
         return above;
     if(value < lower)
         return below;
+    return bin(m_layout->index(value));
+}
 
-    int idx = std::upper_bound(bins.begin(), bins.end(), value) - bins.begin();
-    --idx;
-    return data[idx];
+/** Bootstrap replica of the histogram.
+ *
+ * Equivalent to binning as many values as the histogram contains, drawn
+ * with replacement from its values (including those below and above the
+ * borders), but drawn as multinomial over the counts of the bins in
+ * O(bins), without the values. Non-integer counts, e.g., of rebinned
+ * histograms, are used as weights.
+ */
+template<class Count>
+BasicHistogram<Count> BasicHistogram<Count>::resample(std::mt19937 &rng) const
+{
+    std::vector<double> weights;
+    weights.reserve(data.size() + 2);
+    weights.push_back(below);
+    weights.insert(weights.end(), data.begin(), data.end());
+    weights.push_back(above);
+
+    double total = 0;
+    for(double w : weights)
+        if(w > 0)
+            total += w;
+    const std::vector<int64_t> counts = multinomial(std::llround(total), weights, rng);
+
+    BasicHistogram replica(m_layout);
+    replica.m_first = m_first;
+    replica.data.assign(counts.begin() + 1, counts.end() - 1);
+    replica.below = counts.front();
+    replica.above = counts.back();
+    for(size_t i=0; i<replica.data.size(); ++i)
+        replica.m_sum += counts[i+1];
+    replica.m_total = replica.m_sum;
+    return replica;
 }
 
-double& Histogram::at(int idx)
+/** Adds the entries of another histogram with the same borders.
+ *
+ * Used to combine histograms of parts of the same data.
+ */
+template<class Count>
+BasicHistogram<Count>& BasicHistogram<Count>::operator+=(const BasicHistogram &other)
 {
-    return data[idx];
+    if(num_bins != other.num_bins)
+    {
+        LOG(LOG_ERROR) << "can not add histograms with " << num_bins
+                       << " and " << other.num_bins << " bins";
+        return *this;
+    }
+
+    if(!other.data.empty())
+    {
+        bin(other.m_first);
+        bin(other.m_first + other.data.size() - 1);
+        for(size_t i=0; i<other.data.size(); ++i)
+            data[other.m_first - m_first + i] += other.data[i];
+    }
+    above += other.above;
+    below += other.below;
+    m_total += other.m_total;
+    m_sum += other.m_sum;
+
+    return *this;
+}
+
+template<class Count>
+Count& BasicHistogram<Count>::at(int idx)
+{
+    return bin(idx);
+}
+
+/// count of bin idx, 0 for bins outside of the stored window
+template<class Count>
+Count BasicHistogram<Count>::at(int idx) const
+{
+    if(idx < m_first || idx >= m_first + static_cast<int>(data.size()))
+        return 0;
+    return data[idx - m_first];
 }
 
 /// vector of num_bins elements containing their centers
-const std::vector<double> Histogram::centers() const
+template<class Count>
+const std::vector<double>& BasicHistogram<Count>::centers() const
 {
-    std::vector<double> c;
-    c.reserve(num_bins);
-    for(int i=0; i<num_bins; ++i)
-        c.emplace_back((bins[i] + bins[i+1]) / 2);
-    return c;
+    return m_layout->centers();
 }
 
-/// vector of num_bins elements containing their data
-const std::vector<double>& Histogram::get_data() const
+/** vector of num_bins elements containing their data
+ *
+ * Builds the dense vector also of the empty bins outside of the stored
+ * window. Use at() or the window to access single bins.
+ */
+template<class Count>
+std::vector<Count> BasicHistogram<Count>::get_data() const
+{
+    std::vector<Count> dense(num_bins, 0);
+    std::copy(data.begin(), data.end(), dense.begin() + m_first);
+    return dense;
+}
+
+/// first bin of the stored window, all bins in front of it are empty
+template<class Count>
+int BasicHistogram<Count>::window_begin() const
 {
-    return data;
+    return m_first;
+}
+
+/// end of the stored window, all bins from here on are empty
+template<class Count>
+int BasicHistogram<Count>::window_end() const
+{
+    return m_first + data.size();
 }
 
 /// vector of of num_bins + 1 elements containing their borders
-const std::vector<double>& Histogram::borders() const
+template<class Count>
+const std::vector<double>& BasicHistogram<Count>::borders() const
 {
-    return bins;
+    return m_layout->borders();
+}
+
+/// borders of the bins, shared with all histograms of the same binning
+template<class Count>
+const std::shared_ptr<const BinLayout>& BasicHistogram<Count>::layout() const
+{
+    return m_layout;
 }
 
 /// a string with the data as ascii, two colums
-const std::string Histogram::ascii_table() const
+template<class Count>
+const std::string BasicHistogram<Count>::ascii_table() const
 {
     std::stringstream ss;
     ss << ("# centers counts\n");
-    auto c = centers();
-    auto d = get_data();
+    const auto &c = centers();
     for(int i=0; i<num_bins; ++i)
-        ss << c[i] << " " << d[i] << "\n";
+        ss << c[i] << " " << at(i) << "\n";
     return ss.str();
 }
 
 /// save the histogram to a file, can be loaded by Histogram::readFromFile
-void Histogram::writeToFile(const std::string filename) const
+template<class Count>
+void BasicHistogram<Count>::writeToFile(const std::string filename) const
 {
     std::ofstream os(filename);
     if(!os.good())
@@ -243,19 +522,27 @@ void Histogram::writeToFile(const std::string filename) const
         LOG(LOG_ERROR) << "can not write " << filename;
     }
 
-    for(const auto &i : bins)
+    for(const auto &i : borders())
         os << i << " ";
     os << "\n";
 
-    for(const auto &i : data)
-        os << i << " ";
+    for(int i=0; i<num_bins; ++i)
+        os << at(i) << " ";
     os << "\n";
 }
 
-// load a histogram to a file, as saved by Histogram::writeToFile
-void Histogram::readFromFile(const std::string filename)
+// load a histogram to a file, as saved by Histogram::writeToFile or HistogramCache
+template<class Count>
+void BasicHistogram<Count>::readFromFile(const std::string filename)
 {
-    igzstream is(filename.c_str());
+    Histogram cached;
+    if(HistogramCache::read(filename, cached))
+    {
+        *this = BasicHistogram(cached);
+        return;
+    }
+
+    LineReader is(filename);
     if(!is.good())
     {
         LOG(LOG_ERROR) << "can not read " << filename;
@@ -265,39 +552,26 @@ void Histogram::readFromFile(const std::string filename)
     // the format is pretty strict: 2 lines, in the first borders
     // separated by space, in the second counts separated by whitespace
     // empty lines and lines starting with '#' are ignored
-    std::string lineBorders, lineData;
+    std::string buffer;
+    std::string_view line;
 
-    do
+    if(!getNextLine(is, buffer, line))
     {
-        std::getline(is, lineBorders);
-        if(!is.good())
-        {
-            LOG(LOG_ERROR) << "empty file " << filename;
-            exit(1);
-        }
-    } while(lineBorders.size() == 0 || lineBorders[0] == '#');
+        LOG(LOG_ERROR) << "empty file " << filename;
+        exit(1);
+    }
+    std::vector<double> bins;
+    readWords(line, bins);
 
-    do
+    if(!getNextLine(is, buffer, line))
     {
-        std::getline(is, lineData);
-        if(!is.good() || lineBorders == "")
-        {
-            LOG(LOG_ERROR) << "only borders, no data in file " << filename;
-            exit(1);
-        }
-    } while(lineBorders.size() == 0 || lineBorders[0] == '#');
-
-    std::string item;
-    std::stringstream ss;
-
-    ss.str(lineBorders);
-    while (std::getline(ss, item, ' '))
-        bins.push_back(std::stod(item));
-    ss.clear();
-
-    ss.str(lineData);
-    while (std::getline(ss, item, ' '))
-        data.push_back(std::stod(item));
+        LOG(LOG_ERROR) << "only borders, no data in file " << filename;
+        exit(1);
+    }
+    std::vector<double> counts;
+    readWords(line, counts);
+    m_first = 0;
+    data.assign(counts.begin(), counts.end());
 
     // test if we loaded centers (some of my simulations save centers)
     if(bins.size() == data.size())
@@ -314,6 +588,7 @@ void Histogram::readFromFile(const std::string filename)
     num_bins = bins.size()-1;
     lower = bins.front();
     upper = bins.back();
+    m_layout = std::make_shared<const BinLayout>(bins);
 
     if(bins.size() != data.size() + 1)
     {
@@ -322,11 +597,18 @@ void Histogram::readFromFile(const std::string filename)
     }
 }
 
-std::ostream& operator<<(std::ostream& os, const Histogram &obj)
+template<class Count>
+std::ostream& operator<<(std::ostream& os, const BasicHistogram<Count> &obj)
 {
     os << "[";
     for(int i=0; i<obj.num_bins; ++i)
-        os << "[" <<obj.bins[i] << " - " << obj.bins[i+1] << "] :" << obj.data[i] << std::endl;
+        os << "[" <<obj.borders()[i] << " - " << obj.borders()[i+1] << "] :" << obj.at(i) << std::endl;
     os << "] ";
     return os;
 }
+
+template class BasicHistogram<double>;
+template class BasicHistogram<uint32_t>;
+template class BasicHistogram<uint64_t>;
+
+template std::ostream& operator<<(std::ostream& os, const BasicHistogram<double> &obj);
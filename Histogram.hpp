@@ -2,65 +2,130 @@
 
 #include <vector>
 #include <algorithm>
+#include <cstdint>
+#include <random>
 
 #include <sstream>
 #include <iostream>
 #include <fstream>
 
-#include "gzstream/gzstream.h"
-
 #include "Logging.hpp"
+#include "BinLayout.hpp"
 
 /** Histogram Class.
  *
  * Supports equidistant bins and also definition by passing the their borders.
+ *
+ * The type of the counts is a template parameter: integer counts take
+ * less memory while sampling, such that the bins stay in the cache,
+ * double counts are used for loaded or weighted histograms. All can be
+ * converted into each other. The totals are always 64 bit, such that
+ * the owner of a uint32_t histogram can tell, when its bins may
+ * overflow, see Ingestion.
+ *
+ * The implementation is instantiated for double, uint32_t and uint64_t
+ * in Histogram.cpp.
+ *
+ * Only the window of bins between the first and the last bin with
+ * entries is stored, such that very fine binnings of data, which
+ * populates only a narrow part of the range, need little memory.
  */
-class Histogram
+template<class Count>
+class BasicHistogram
 {
     protected:
         int num_bins;         ///< total number of bins
         double lower;         ///< lower bound of the histogram
         double upper;         ///< upper bound of the histogram
 
-        int m_cur_min;        ///< current minimum entry in the histogram
-        int m_total;          ///< total number of inserted data points
-        int m_sum;            ///< sum of all bins
+        int64_t m_total;      ///< total number of inserted data points
+        int64_t m_sum;        ///< sum of all bins
 
-        double above;
-        double below;
+        Count above;
+        Count below;
 
-        std::vector<double> bins; ///< num_bins + 1 bin borders
-        std::vector<double> data; ///< data inside the bins
+        std::shared_ptr<const BinLayout> m_layout;  ///< borders of the bins, shared with all histograms of the same binning
+        int m_first;              ///< first bin stored in data
+        std::vector<Count> data;  ///< data inside the bins from m_first on, all other bins are empty
+
+        Count& bin(int idx);
+        void grow(int idx);
+
+        template<class> friend class BasicHistogram;
+        friend class ConcurrentHistogram;
+        friend class HistogramCache;
 
     public:
-        Histogram();
-        Histogram(const int bins, const double lower, const double upper);
-        Histogram(const std::vector<double> bins);
-        Histogram(const std::string filename);
+        BasicHistogram();
+        BasicHistogram(const int bins, const double lower, const double upper);
+        BasicHistogram(const std::vector<double> bins);
+        BasicHistogram(std::shared_ptr<const BinLayout> layout);
+        BasicHistogram(const std::string filename);
+        template<class Other>
+        explicit BasicHistogram(const BasicHistogram<Other> &other);
 
         void add(double where, double what=1);
-        double& at(int idx);
+        void add(const double *begin, const double *end);
+        void rebin(const BasicHistogram &source, int first, int last);
+        Count& at(int idx);
+        Count at(int idx) const;
 
         int get_num_bins() const;
-        int min() const;
+        Count min() const;
         double mean() const;
-        int sum() const;
-        int count() const;
+        int64_t sum() const;
+        int64_t count() const;
         void reset();
         void trim();
 
         void writeToFile(const std::string filename) const;
         void readFromFile(const std::string filename);
 
-        const std::vector<double> centers() const;
+        const std::vector<double>& centers() const;
         const std::vector<double>& borders() const;
-        const std::vector<double>& get_data() const;
+        const std::shared_ptr<const BinLayout>& layout() const;
+        std::vector<Count> get_data() const;
+        int window_begin() const;
+        int window_end() const;
         const std::string ascii_table() const;
 
-        double operator[](const double value) const;
-        double& operator[](const double value);
+        Count operator[](const double value) const;
+        Count& operator[](const double value);
 
-        Histogram& operator+=(const Histogram &other);
+        BasicHistogram resample(std::mt19937 &rng) const;
+        BasicHistogram& operator+=(const BasicHistogram &other);
 
-        friend std::ostream& operator<<(std::ostream& os, const Histogram &obj);
+        template<class C>
+        friend std::ostream& operator<<(std::ostream& os, const BasicHistogram<C> &obj);
 };
+
+/** Convert the counts of another histogram, e.g., integer counts of
+ * sampling into a histogram with double counts for glueing.
+ */
+template<class Count>
+template<class Other>
+BasicHistogram<Count>::BasicHistogram(const BasicHistogram<Other> &other)
+    : num_bins(other.num_bins),
+      lower(other.lower),
+      upper(other.upper),
+      m_total(other.m_total),
+      m_sum(other.m_sum),
+      above(other.above),
+      below(other.below),
+      m_layout(other.m_layout),
+      m_first(other.m_first),
+      data(other.data.begin(), other.data.end())
+{
+}
+
+template<class Count>
+std::ostream& operator<<(std::ostream& os, const BasicHistogram<Count> &obj);
+
+/// histogram for loaded, weighted or glued data
+using Histogram = BasicHistogram<double>;
+
+/// histogram of sampled data, compact enough for the cache
+using CountHistogram = BasicHistogram<uint32_t>;
+
+/// histogram of sampled data, whose bins may exceed 2^32 counts
+using WideCountHistogram = BasicHistogram<uint64_t>;
@@ -0,0 +1,502 @@
+#include "HistogramCache.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <tuple>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "MappedFile.hpp"
+#include "Logging.hpp"
+
+/// identifies histogram caches and their version
+static const char CACHE_MAGIC[8] = {'G', 'L', 'U', 'E', 'H', 'S', 'T', '2'};
+
+/// identifies sample caches and their version
+static const char SAMPLES_MAGIC[8] = {'G', 'L', 'U', 'E', 'S', 'M', 'P', '1'};
+
+/// header of a sample cache, followed by the sorted samples
+struct SamplesHeader
+{
+    char magic[8];
+    HistogramCache::Fingerprint key;    ///< without binning
+    double tau;             ///< estimated autocorrelation time, 1 if the step was given
+    uint64_t num_samples;
+};
+
+/// header of a cache file, followed by the borders and the counts of the window
+struct CacheHeader
+{
+    char magic[8];
+    HistogramCache::Fingerprint key;
+    double tau;             ///< estimated autocorrelation time, 1 if the step was given
+    int64_t total;
+    int64_t sum;
+    double above;
+    double below;
+    int64_t first;          ///< first bin of the stored window
+    uint64_t window;        ///< number of stored counts
+    HistogramCache::Progress progress;
+    uint64_t prefix_hash;   ///< hash of the source in front of progress.offset
+};
+
+std::string HistogramCache::directory;
+uint64_t HistogramCache::size_limit = 0;
+
+/// FNV-1a hash of n bytes
+static uint64_t hashBytes(const char *data, size_t n, uint64_t hash=14695981039346656037ull)
+{
+    for(size_t i=0; i<n; ++i)
+    {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+/** Hash of the first size bytes of a file.
+ *
+ * Only the first and last 64 KiB are hashed, which is cheap even for
+ * huge files and still changes when a simulation is rerun.
+ */
+static uint64_t prefixHash(const std::string &filename, uint64_t size)
+{
+    const int fd = open(filename.c_str(), O_RDONLY);
+    if(fd < 0)
+        return 0;
+
+    const uint64_t block = 1 << 16;
+    std::vector<char> buf(block);
+    ssize_t n = pread(fd, buf.data(), std::min(block, size), 0);
+    uint64_t hash = hashBytes(buf.data(), std::max<ssize_t>(n, 0));
+    if(size > block)
+    {
+        n = pread(fd, buf.data(), block, size - block);
+        hash = hashBytes(buf.data(), std::max<ssize_t>(n, 0), hash);
+    }
+    close(fd);
+
+    return hash;
+}
+
+static bool hasSuffix(const std::string &name, const std::string &suffix)
+{
+    return name.size() >= suffix.size() && name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+/// name of a temporary file to write filename, unique among threads and processes
+std::string HistogramCache::temporaryName(const std::string &filename)
+{
+    std::random_device device;
+    return filename + "." + std::to_string(getpid()) + "." + std::to_string(device()) + ".tmp";
+}
+
+/// replace filename by the completely written temporary file tmp
+void HistogramCache::replace(const std::string &tmp, const std::string &filename, bool good)
+{
+    if(!good || std::rename(tmp.c_str(), filename.c_str()) != 0)
+    {
+        LOG(LOG_DEBUG) << "can not write " << filename;
+        unlink(tmp.c_str());
+    }
+}
+
+/** Save all caches in a directory shared by all runs.
+ *
+ * \param dir    cache directory, created if it does not exist, empty to
+ *               save the caches next to the sources
+ * \param limit  size limit of the directory in bytes, 0 for no limit
+ */
+void HistogramCache::setDirectory(const std::string &dir, uint64_t limit)
+{
+    directory = dir;
+    size_limit = limit;
+    if(!directory.empty() && mkdir(directory.c_str(), 0777) != 0 && errno != EEXIST)
+    {
+        LOG(LOG_WARNING) << "can not create cache directory " << directory;
+    }
+}
+
+/** Name of the cache of a histogram.
+ *
+ * In the directory, the cache is named by the absolute path of the
+ * source and the evaluation, but not by the identity of the source,
+ * such that it is found again, when the source was appended to.
+ *
+ * \param filename  name of the cache next to the source, its extension is kept
+ * \param source    data file the histogram is evaluated from
+ * \param key       fingerprint of the evaluation
+ */
+std::string HistogramCache::fileName(const std::string &filename, const std::string &source, const Fingerprint &key)
+{
+    if(directory.empty())
+        return filename;
+
+    Fingerprint evaluation = key;
+    evaluation.source_size = 0;
+    evaluation.source_mtime = 0;
+    evaluation.source_hash = 0;
+    char *path = realpath(source.c_str(), nullptr);
+    uint64_t hash = hashBytes(reinterpret_cast<const char*>(&evaluation), sizeof(evaluation));
+    hash = path ? hashBytes(path, std::strlen(path), hash) : hashBytes(source.data(), source.size(), hash);
+    free(path);
+
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(hash));
+    const size_t dot = filename.rfind('.');
+    return directory + "/" + name + (dot == std::string::npos ? "" : filename.substr(dot));
+}
+
+/** Remove the least recently used caches, until the directory is
+ * smaller than its limit.
+ *
+ * Other runs may use the directory at the same time. Caches removed
+ * while they are read stay valid for the reader, caches removed by
+ * another run are skipped.
+ */
+void HistogramCache::evict()
+{
+    if(directory.empty() || !size_limit)
+        return;
+
+    DIR *dir = opendir(directory.c_str());
+    if(!dir)
+        return;
+
+    // (last use, size, name) of every cache
+    std::vector<std::tuple<int64_t, uint64_t, std::string>> caches;
+    uint64_t total = 0;
+    const int64_t now = time(nullptr);
+    while(dirent *entry = readdir(dir))
+    {
+        const std::string name = directory + "/" + entry->d_name;
+        struct stat st;
+        if(stat(name.c_str(), &st) != 0 || !S_ISREG(st.st_mode))
+            continue;
+
+        // temporary files of crashed runs
+        if(hasSuffix(name, ".tmp") && now - st.st_mtime > 86400)
+            unlink(name.c_str());
+        if(!hasSuffix(name, ".hist") && !hasSuffix(name, ".samples") && !hasSuffix(name, ".stats")
+           && !hasSuffix(name, ".gzidx"))
+            continue;
+
+        caches.emplace_back(st.st_mtime, st.st_size, name);
+        total += st.st_size;
+    }
+    closedir(dir);
+
+    std::sort(caches.begin(), caches.end());
+    for(const auto &cache : caches)
+    {
+        if(total <= size_limit)
+            break;
+        unlink(std::get<2>(cache).c_str());
+        total -= std::get<1>(cache);
+    }
+    LOG(LOG_DEBUG) << "histogram cache " << directory << " uses " << total << " bytes";
+}
+
+/// whether both fingerprints describe the same evaluation, maybe of different sources
+bool HistogramCache::Fingerprint::sameEvaluation(const Fingerprint &other) const
+{
+    return column == other.column
+        && skip == other.skip
+        && step == other.step
+        && num_bins == other.num_bins
+        && lower == other.lower
+        && upper == other.upper;
+}
+
+/// whether both fingerprints describe the same source
+bool HistogramCache::Fingerprint::sameSource(const Fingerprint &other) const
+{
+    return source_size == other.source_size
+        && source_mtime == other.source_mtime
+        && source_hash == other.source_hash;
+}
+
+/// fingerprint of the decimated samples, which do not depend on the binning
+HistogramCache::Fingerprint HistogramCache::unbinned(const Fingerprint &key)
+{
+    Fingerprint samples = key;
+    samples.num_bins = 0;
+    samples.lower = 0;
+    samples.upper = 0;
+    return samples;
+}
+
+/** Fingerprint of the evaluation of a column of the source file.
+ *
+ * The source is identified by its size, mtime and prefixHash().
+ */
+HistogramCache::Fingerprint HistogramCache::fingerprint(const std::string &source, int column, int skip, int step, int num_bins, double lower, double upper)
+{
+    Fingerprint key;
+    std::memset(&key, 0, sizeof(key));
+    key.column = column;
+    key.skip = skip;
+    key.step = step;
+    key.num_bins = num_bins;
+    key.lower = lower;
+    key.upper = upper;
+
+    struct stat st;
+    if(stat(source.c_str(), &st) != 0)
+        return key;
+    key.source_size = st.st_size;
+    key.source_mtime = st.st_mtime;
+    key.source_hash = prefixHash(source, key.source_size);
+
+    return key;
+}
+
+/// tests if the given file is a histogram cache, by its magic bytes
+bool HistogramCache::isCacheFile(const std::string &filename)
+{
+    std::ifstream is(filename, std::ios::binary);
+    char magic[sizeof(CACHE_MAGIC)] = {};
+    is.read(magic, sizeof(magic));
+    return is.good() && std::memcmp(magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) == 0;
+}
+
+/** Load a cached histogram, if it was created by the same evaluation
+ * of the same source or of its beginning.
+ *
+ * \param source    data file the histogram is evaluated from
+ * \param key       fingerprint of the current evaluation
+ * \param tau       estimated autocorrelation time of the cached evaluation
+ * \param progress  how far the source was evaluated, if APPENDED
+ */
+HistogramCache::Match HistogramCache::load(const std::string &filename, const std::string &source, const Fingerprint &key, Histogram &hist, double &tau, Progress &progress)
+{
+    const Match match = map(filename, source, &key, hist, tau, progress);
+
+    // the modification time of a cache in the directory is its last use
+    if(match != MISS && !directory.empty())
+        utimensat(AT_FDCWD, filename.c_str(), nullptr, 0);
+    return match;
+}
+
+/// load a cached histogram, regardless of how it was created
+bool HistogramCache::read(const std::string &filename, Histogram &hist)
+{
+    double tau;
+    Progress progress;
+    return map(filename, "", nullptr, hist, tau, progress) != MISS;
+}
+
+HistogramCache::Match HistogramCache::map(const std::string &filename, const std::string &source, const Fingerprint *key, Histogram &hist, double &tau, Progress &progress)
+{
+    MappedFile file(filename);
+    const std::string_view all = file.view();
+    if(!file.good() || all.size() < sizeof(CacheHeader))
+        return MISS;
+
+    CacheHeader header;
+    std::memcpy(&header, all.data(), sizeof(header));
+    if(std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0)
+        return MISS;
+
+    Match match = COMPLETE;
+    if(key)
+    {
+        if(!header.key.sameEvaluation(*key))
+            return MISS;
+        // a source, which is longer, but starts with the same data, was appended to
+        if(!header.key.sameSource(*key))
+        {
+            const uint64_t offset = header.progress.offset;
+            if(!offset || key->source_size < offset || prefixHash(source, offset) != header.prefix_hash)
+                return MISS;
+            match = APPENDED;
+        }
+    }
+
+    const int num_bins = header.key.num_bins;
+    const size_t borders_size = (num_bins + 1) * sizeof(double);
+    const size_t counts_size = header.window * sizeof(double);
+    // first and window are not added, such that huge values can not wrap around
+    if(num_bins < 0 || header.first < 0 || header.window > static_cast<uint64_t>(num_bins)
+       || static_cast<uint64_t>(header.first) > num_bins - header.window
+       || all.size() != sizeof(header) + borders_size + counts_size)
+    {
+        LOG(LOG_WARNING) << "corrupt histogram cache " << filename;
+        return MISS;
+    }
+
+    // the binning of a matching cache is equidistant, share the layout
+    if(key)
+        hist = Histogram(BinLayout::equidistantLayout(num_bins, header.key.lower, header.key.upper));
+    else
+    {
+        std::vector<double> borders(num_bins + 1);
+        std::memcpy(borders.data(), all.data() + sizeof(header), borders_size);
+        hist = Histogram(borders);
+    }
+
+    hist.data.resize(header.window);
+    std::memcpy(hist.data.data(), all.data() + sizeof(header) + borders_size, counts_size);
+    hist.m_first = header.first;
+    hist.m_total = header.total;
+    hist.m_sum = header.sum;
+    hist.above = header.above;
+    hist.below = header.below;
+    tau = header.tau;
+    progress = header.progress;
+
+    return match;
+}
+
+/** Save a histogram with the fingerprint of its evaluation.
+ *
+ * The cache is written to a temporary file, which is renamed, such that
+ * readers see either the old or the complete new cache. Failing to
+ * write is not an error, the histogram is evaluated again next time.
+ *
+ * \param source    data file the histogram was evaluated from
+ * \param key       fingerprint of the evaluation
+ * \param tau       estimated autocorrelation time, for the log of later runs
+ * \param progress  how far the source was evaluated, offset 0 if
+ *                  appended data can not be evaluated separately
+ */
+void HistogramCache::save(const std::string &filename, const std::string &source, const Fingerprint &key, const Histogram &hist, double tau, const Progress &progress)
+{
+    CacheHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.key = key;
+    header.tau = tau;
+    header.total = hist.m_total;
+    header.sum = hist.m_sum;
+    header.above = hist.above;
+    header.below = hist.below;
+    header.first = hist.m_first;
+    header.window = hist.data.size();
+    header.progress = progress;
+    if(progress.offset)
+        header.prefix_hash = prefixHash(source, progress.offset);
+
+    const std::string tmp = temporaryName(filename);
+    std::ofstream os(tmp, std::ios::binary);
+    if(!os.good())
+    {
+        LOG(LOG_DEBUG) << "can not write " << filename;
+        return;
+    }
+
+    const auto &borders = hist.borders();
+    os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    os.write(reinterpret_cast<const char*>(borders.data()), borders.size() * sizeof(double));
+    os.write(reinterpret_cast<const char*>(hist.data.data()), hist.data.size() * sizeof(double));
+    os.close();
+    replace(tmp, filename, os.good());
+}
+
+/** Derive a histogram from cached samples of the same source, evaluated
+ * with the same column, skip and step.
+ *
+ * The counts of the bins are differences of the positions of their
+ * borders in the sorted samples, found by binary search, such that they
+ * are exactly the counts of binning the samples.
+ *
+ * \param key  fingerprint of the current evaluation, including the binning
+ * \param tau  estimated autocorrelation time of the cached evaluation
+ * \return COMPLETE or MISS
+ */
+HistogramCache::Match HistogramCache::loadSamples(const std::string &filename, const Fingerprint &key, Histogram &hist, double &tau)
+{
+    MappedFile file(filename);
+    const std::string_view all = file.view();
+    if(!file.good() || all.size() < sizeof(SamplesHeader))
+        return MISS;
+
+    SamplesHeader header;
+    std::memcpy(&header, all.data(), sizeof(header));
+    const Fingerprint wanted = unbinned(key);
+    if(std::memcmp(header.magic, SAMPLES_MAGIC, sizeof(SAMPLES_MAGIC)) != 0
+       || !header.key.sameEvaluation(wanted) || !header.key.sameSource(wanted))
+        return MISS;
+    if(all.size() != sizeof(header) + header.num_samples * sizeof(double))
+    {
+        LOG(LOG_WARNING) << "corrupt sample cache " << filename;
+        return MISS;
+    }
+
+    const double *begin = reinterpret_cast<const double*>(all.data() + sizeof(header));
+    const double *end = begin + header.num_samples;
+
+    hist = Histogram(BinLayout::equidistantLayout(key.num_bins, key.lower, key.upper));
+    const std::vector<double> &borders = hist.borders();
+
+    // number of samples below every border
+    std::vector<uint64_t> below(borders.size());
+    const double *pos = begin;
+    for(size_t i=0; i<borders.size(); ++i)
+    {
+        pos = std::lower_bound(pos, end, borders[i]);
+        below[i] = pos - begin;
+    }
+
+    for(int i=0; i<key.num_bins; ++i)
+    {
+        const uint64_t count = below[i+1] - below[i];
+        if(!count)
+            continue;
+        hist.bin(i) += count;
+        hist.m_total += count;
+        hist.m_sum += count;
+    }
+    hist.below = below.front();
+    hist.above = header.num_samples - below.back();
+    tau = header.tau;
+
+    if(!directory.empty())
+        utimensat(AT_FDCWD, filename.c_str(), nullptr, 0);
+    return COMPLETE;
+}
+
+/** Save the decimated samples of an evaluation sorted, such that
+ * histograms with other bins can be derived by loadSamples().
+ *
+ * Samples containing NaN can not be sorted and are not saved.
+ *
+ * \param key      fingerprint of the evaluation, the binning is ignored
+ * \param samples  decimated samples in any order
+ * \param tau      estimated autocorrelation time, for the log of later runs
+ */
+void HistogramCache::saveSamples(const std::string &filename, const Fingerprint &key, std::vector<double> samples, double tau)
+{
+    for(const double &x : samples)
+        if(std::isnan(x))
+            return;
+    std::sort(samples.begin(), samples.end());
+
+    SamplesHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, SAMPLES_MAGIC, sizeof(SAMPLES_MAGIC));
+    header.key = unbinned(key);
+    header.tau = tau;
+    header.num_samples = samples.size();
+
+    const std::string tmp = temporaryName(filename);
+    std::ofstream os(tmp, std::ios::binary);
+    if(!os.good())
+    {
+        LOG(LOG_DEBUG) << "can not write " << filename;
+        return;
+    }
+
+    os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    os.write(reinterpret_cast<const char*>(samples.data()), samples.size() * sizeof(double));
+    os.close();
+    replace(tmp, filename, os.good());
+}
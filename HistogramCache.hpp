@@ -0,0 +1,94 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+#include "Histogram.hpp"
+
+/** Binary cache of the histogram of one column of a data file.
+ *
+ * The file starts with a header containing the fingerprint of the
+ * evaluation, i.e., the column, skip, step and binning it was created
+ * with and the identity of the source file, followed by the borders and
+ * the stored window of the counts. The counts are saved exactly and
+ * loaded from a memory mapping without any parsing.
+ *
+ * A cache is only used, if its fingerprint equals the one of the
+ * current evaluation, such that changed arguments or a regenerated
+ * source file never reuse stale data.
+ *
+ * Caches of uncompressed text files also record how far the source was
+ * read. If data was appended to the source since, e.g., by a running
+ * simulation, only the appended lines need to be evaluated and added.
+ *
+ * Optionally, the sorted decimated samples are cached as well, without
+ * binning. Histograms with any other bins are derived from them exactly
+ * in O(bins log N), without reading the source again.
+ *
+ * The caches are saved next to the source files or, if set by
+ * setDirectory(), in a directory shared by all runs, named by the hash
+ * of the path of the source and the evaluation. Caches are written to a temporary file and
+ * renamed, such that concurrent runs never see partial files and
+ * readers need no locks. The least recently used caches are removed by
+ * evict(), when the directory exceeds its size limit.
+ */
+class HistogramCache
+{
+    public:
+        /// everything the histogram of a data file depends on
+        struct Fingerprint
+        {
+            int32_t column;
+            int32_t skip;
+            int32_t step;           ///< requested step, 0 if estimated from the data
+            int32_t num_bins;
+            double lower;
+            double upper;
+            uint64_t source_size;
+            int64_t source_mtime;
+            uint64_t source_hash;   ///< hash of the beginning and the end of the source
+
+            bool sameEvaluation(const Fingerprint &other) const;
+            bool sameSource(const Fingerprint &other) const;
+        };
+
+        /// how far a source was evaluated, to continue with appended data
+        struct Progress
+        {
+            uint64_t offset;        ///< bytes of the source evaluated, 0 if it can not be continued
+            int64_t lines;          ///< data lines in front of offset
+            int32_t step;           ///< step used, also if estimated
+        };
+
+        /// result of loading a cache
+        enum Match
+        {
+            MISS,                   ///< no usable cache
+            COMPLETE,               ///< the cache contains all data of the source
+            APPENDED                ///< the source was appended to, after the data in the cache
+        };
+
+        static Fingerprint fingerprint(const std::string &source, int column, int skip, int step, int num_bins, double lower, double upper);
+        static Fingerprint unbinned(const Fingerprint &key);
+
+        static void setDirectory(const std::string &dir, uint64_t limit);
+        static std::string fileName(const std::string &filename, const std::string &source, const Fingerprint &key);
+        static void evict();
+
+        static bool isCacheFile(const std::string &filename);
+        static Match load(const std::string &filename, const std::string &source, const Fingerprint &key, Histogram &hist, double &tau, Progress &progress);
+        static bool read(const std::string &filename, Histogram &hist);
+        static void save(const std::string &filename, const std::string &source, const Fingerprint &key, const Histogram &hist, double tau, const Progress &progress);
+
+        static Match loadSamples(const std::string &filename, const Fingerprint &key, Histogram &hist, double &tau);
+        static void saveSamples(const std::string &filename, const Fingerprint &key, std::vector<double> samples, double tau);
+
+        static std::string temporaryName(const std::string &filename);
+        static void replace(const std::string &tmp, const std::string &filename, bool good);
+
+    protected:
+        static std::string directory;   ///< shared cache directory, empty to save next to the sources
+        static uint64_t size_limit;     ///< size limit of the directory in bytes
+
+        static Match map(const std::string &filename, const std::string &source, const Fingerprint *key, Histogram &hist, double &tau, Progress &progress);
+};
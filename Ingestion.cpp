@@ -0,0 +1,351 @@
+#include "Ingestion.hpp"
+
+bool Ingestion::concurrent = false;
+
+/** Construct an ingestion for one column of one file.
+ *
+ * \param skip  number of data lines to discard at the beginning
+ * \param step  use only every step-th line, if 0 use twice the
+ *              autocorrelation time estimated from the data
+ */
+Ingestion::Ingestion(int64_t skip, int step)
+    : skip(skip),
+      m_step(step),
+      ctr(0),
+      track_range(false),
+      keep_samples(false),
+      binned(false),
+      m_min(std::numeric_limits<double>::infinity()),
+      m_max(-std::numeric_limits<double>::infinity()),
+      m_tau(1),
+      // use this many samples to determine the autocorrelation time
+      num_samples(64)
+{
+}
+
+/// determine the smallest and largest value of all lines after skip
+void Ingestion::trackRange()
+{
+    track_range = true;
+}
+
+/// keep the decimated samples (e.g. for the sample cache)
+void Ingestion::keepSamples()
+{
+    keep_samples = true;
+}
+
+/** Continue after data lines, which were evaluated before, e.g., by a
+ * previous run, whose histogram is added later, or which need not be
+ * read, since they are skipped anyway.
+ *
+ * The step needs to be given, such that the same lines are used, unless
+ * lines is not larger than skip.
+ *
+ * \param lines  number of data lines evaluated before
+ */
+void Ingestion::resume(int64_t lines)
+{
+    ctr = lines;
+}
+
+/** Use the autocorrelation time estimated by an earlier evaluation of
+ * the same data, instead of estimating it again.
+ *
+ * The step is derived from tau as by the estimation, such that exactly
+ * the same lines are used. Only valid, if no step was given.
+ */
+void Ingestion::useTau(double tau)
+{
+    m_tau = tau;
+    m_step = std::ceil(2*m_tau);
+}
+
+/** Let the threads evaluating parts of a file fill one histogram of
+ * atomic counters instead of a copy each.
+ *
+ * Saves memory for very many bins, but is slower for few bins, since
+ * the threads contend for the same bins. Disabled by default.
+ */
+void Ingestion::setConcurrent(bool enable)
+{
+    concurrent = enable;
+}
+
+/** Prepare for forking parts, which are evaluated in parallel.
+ *
+ * If enabled by setConcurrent(), all parts forked afterwards add their
+ * samples to a shared histogram, which is added to the histogram of
+ * this ingestion by finish(). Must not be called in parallel to fork().
+ */
+void Ingestion::share()
+{
+    if(concurrent && binned && !shared)
+        shared = std::make_shared<ConcurrentHistogram>(hist.layout());
+}
+
+/** Create an empty ingestion with the same settings, which continues
+ * after the given number of data lines.
+ *
+ * Used to evaluate parts of a file in parallel. The step needs to be
+ * known.
+ *
+ * \param lines  number of data lines in front of the part
+ */
+Ingestion Ingestion::fork(int64_t lines) const
+{
+    Ingestion part(skip, m_step);
+    part.ctr = lines;
+    part.track_range = track_range;
+    part.keep_samples = keep_samples;
+    part.binned = binned;
+    part.m_tau = m_tau;
+    if(binned)
+    {
+        part.hist = CountHistogram(hist.layout());
+        part.folded = WideCountHistogram(hist.layout());
+        part.shared = shared;
+    }
+    return part;
+}
+
+/** Combine with an ingestion of a later part of the file.
+ *
+ * Parts need to be merged in the order of the file, such that the
+ * kept samples stay in order.
+ */
+void Ingestion::merge(const Ingestion &other)
+{
+    ctr = std::max(ctr, other.ctr);
+    m_min = std::min(m_min, other.m_min);
+    m_max = std::max(m_max, other.m_max);
+    if(binned)
+    {
+        promote(other.hist.count());
+        hist += other.hist;
+        folded += other.folded;
+        addBinned(other.unbinned);
+    }
+    m_samples.insert(m_samples.end(), other.m_samples.begin(), other.m_samples.end());
+}
+
+/** Set the borders of the histogram.
+ *
+ * All samples that were collected so far are binned, further samples
+ * are binned directly.
+ */
+void Ingestion::bin(int num_bins, double lower, double upper)
+{
+    hist = CountHistogram(num_bins, lower, upper);
+    folded = WideCountHistogram(hist.layout());
+    binned = true;
+    for(size_t begin=0; begin<m_samples.size(); begin+=4096)
+    {
+        const size_t end = std::min(m_samples.size(), begin + 4096);
+        promote(end - begin);
+        hist.add(m_samples.data() + begin, m_samples.data() + end);
+    }
+
+    if(!keep_samples)
+        std::vector<double>().swap(m_samples);
+}
+
+/** Registers the next data line.
+ *
+ * \return true, if the value of this line is needed, i.e., add() should be called
+ */
+bool Ingestion::next()
+{
+    ++ctr;
+    if(ctr <= skip)
+        return false;
+    if(track_range || !m_step)
+        return true;
+    return (ctr-skip) % m_step == 0;
+}
+
+/// value of the data line registered last by next()
+void Ingestion::add(double value)
+{
+    if(track_range)
+    {
+        if(value < m_min)
+            m_min = value;
+        if(value > m_max)
+            m_max = value;
+    }
+
+    if(!m_step)
+    {
+        pending.push_back(value);
+
+        if((int) pending.size() == num_samples)
+        {
+            m_tau = autocorrelationTime(pending);
+            // if the autocorrelation time is of the same order of the
+            // number of samples, try again with more samples
+            if(m_tau > num_samples/100.)
+                num_samples *= 2;
+            else
+            {
+                m_step = std::ceil(2*m_tau);
+                decimatePending();
+            }
+        }
+        return;
+    }
+
+    if((ctr-skip) % m_step)
+        return;
+
+    accept(value);
+}
+
+/// no more data lines, use the last estimate of tau, if it did not converge
+void Ingestion::finish()
+{
+    if(!m_step)
+    {
+        m_step = std::ceil(2*m_tau);
+        decimatePending();
+    }
+    flush();
+
+    if(shared)
+    {
+        shared->addTo(folded);
+        shared.reset();
+    }
+}
+
+void Ingestion::accept(double value)
+{
+    if(binned)
+    {
+        unbinned.push_back(value);
+        if(unbinned.size() == 4096)
+            flush();
+    }
+    if(keep_samples || !binned)
+        m_samples.push_back(value);
+}
+
+/// add the waiting samples to the histogram
+void Ingestion::flush()
+{
+    addBinned(unbinned);
+    unbinned.clear();
+}
+
+/// add samples to the shared histogram, if there is one, otherwise to hist
+void Ingestion::addBinned(const std::vector<double> &values)
+{
+    if(shared)
+        shared->add(values.data(), values.data() + values.size());
+    else
+    {
+        promote(values.size());
+        hist.add(values.data(), values.data() + values.size());
+    }
+}
+
+/** Move the counts of hist into folded, if adding n more entries could
+ * overflow its 32 bit bins.
+ *
+ * No bin holds more than all entries, so it suffices to compare the
+ * total. This happens once per 2^32 samples, such that hist stays
+ * compact while sampling.
+ */
+void Ingestion::promote(uint64_t n)
+{
+    if(hist.count() + n <= std::numeric_limits<uint32_t>::max())
+        return;
+    folded += WideCountHistogram(hist);
+    hist.reset();
+}
+
+/// take every m_step-th of the samples collected while the step was unknown
+void Ingestion::decimatePending()
+{
+    for(size_t k=0; k<pending.size(); ++k)
+        if((k+1) % m_step == 0)
+            accept(pending[k]);
+    std::vector<double>().swap(pending);
+}
+
+/// whether the step is known, i.e., tau is estimated, if it was not given
+bool Ingestion::stepKnown() const
+{
+    return m_step;
+}
+
+/// use every step-th line after skip, only valid if stepKnown()
+int Ingestion::step() const
+{
+    return m_step;
+}
+
+/// estimated autocorrelation time (1, if the step was given)
+double Ingestion::tau() const
+{
+    return m_tau;
+}
+
+/// number of data lines seen so far
+int64_t Ingestion::lines() const
+{
+    return ctr;
+}
+
+/// number of data lines discarded at the beginning
+int64_t Ingestion::skipped() const
+{
+    return skip;
+}
+
+/// smallest value after skip, needs trackRange()
+double Ingestion::minimum() const
+{
+    return m_min;
+}
+
+/// largest value after skip, needs trackRange()
+double Ingestion::maximum() const
+{
+    return m_max;
+}
+
+/** Widen the given range such that it contains all values after skip.
+ *
+ * A margin of 5% is added on both sides. Needs trackRange().
+ *
+ * \param[in,out]  lower  smallest value of the data or given value
+ * \param[in,out]  upper  largest value of the data or given value
+ */
+void Ingestion::range(double &lower, double &upper) const
+{
+    lower = std::min(lower, m_min);
+    upper = std::max(upper, m_max);
+    widen(lower, upper);
+}
+
+/// add the margin of range() to the range of the data
+void Ingestion::widen(double &lower, double &upper)
+{
+    lower -= 0.05*(upper-lower);
+    upper += 0.05*(upper-lower);
+}
+
+/// histogram of the decimated samples, only valid after bin() and finish()
+Histogram Ingestion::histogram() const
+{
+    Histogram h(hist);
+    h += Histogram(folded);
+    return h;
+}
+
+/// decimated samples, if kept or not yet binned
+const std::vector<double>& Ingestion::samples() const
+{
+    return m_samples;
+}
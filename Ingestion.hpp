@@ -0,0 +1,95 @@
+#pragma once
+
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+#include "Histogram.hpp"
+#include "ConcurrentHistogram.hpp"
+#include "autocorrelation.hpp"
+
+/** Evaluates one column of a raw data file in a single pass.
+ *
+ * The data lines are fed one after another. On the way the range of the
+ * data, the autocorrelation time (if no step is given) and the histogram
+ * of the decimated samples are determined, such that every file needs to
+ * be read (and decompressed) only once.
+ *
+ * If the step is not known, all samples after skip are kept until the
+ * autocorrelation time is estimated and decimated afterwards. If the
+ * borders of the histogram are not known up front, the decimated samples
+ * are kept and binned later by bin().
+ *
+ * Usage: for every data line call next() and, if it returns true, add()
+ * with the value of that line. Call finish() at the end of the data.
+ *
+ * Once the step is known, parts of a file can be evaluated independently
+ * by ingestions created with fork(), which are combined with merge().
+ * If enabled by setConcurrent(), parts forked after share() fill one
+ * ConcurrentHistogram instead of a histogram each.
+ */
+class Ingestion
+{
+    protected:
+        int64_t skip;         ///< number of data lines to discard (~ equilibration time)
+        int m_step;           ///< use only every m_step-th line, 0 while unknown
+        int64_t ctr;          ///< number of data lines seen so far
+
+        bool track_range;     ///< determine minimum and maximum of the data
+        bool keep_samples;    ///< keep the decimated samples, even if binned
+        bool binned;          ///< whether the borders of the histogram are known
+
+        double m_min;         ///< smallest value after skip
+        double m_max;         ///< largest value after skip
+
+        double m_tau;         ///< current estimate of the autocorrelation time
+        int num_samples;      ///< number of samples for the next estimate of tau
+
+        std::vector<double> pending;    ///< undecimated samples while the step is unknown
+        std::vector<double> m_samples;  ///< decimated samples, if kept or not yet binned
+        std::vector<double> unbinned;   ///< decimated samples waiting to be added to hist in one batch
+        CountHistogram hist;            ///< histogram of the decimated samples, with compact counts
+        WideCountHistogram folded;      ///< counts moved out of hist, before they could overflow
+        std::shared_ptr<ConcurrentHistogram> shared;    ///< histogram filled by all forked parts, see share()
+
+        static bool concurrent;
+
+        void accept(double value);
+        void decimatePending();
+        void flush();
+        void addBinned(const std::vector<double> &values);
+        void promote(uint64_t n);
+
+    public:
+        Ingestion(int64_t skip=0, int step=0);
+
+        void trackRange();
+        void keepSamples();
+        void bin(int num_bins, double lower, double upper);
+
+        bool next();
+        void add(double value);
+        void finish();
+
+        void resume(int64_t lines);
+        void useTau(double tau);
+        void share();
+        Ingestion fork(int64_t lines) const;
+        void merge(const Ingestion &other);
+
+        bool stepKnown() const;
+        int step() const;
+        double tau() const;
+        int64_t lines() const;
+        int64_t skipped() const;
+        double minimum() const;
+        double maximum() const;
+        void range(double &lower, double &upper) const;
+
+        Histogram histogram() const;
+        const std::vector<double>& samples() const;
+
+        static void setConcurrent(bool enable);
+        static void widen(double &lower, double &upper);
+};
@@ -0,0 +1,91 @@
+#include "LineReader.hpp"
+
+#include <cstring>
+
+/** Open a file, its format is detected by openDecompressor().
+ *
+ * \param filename      file to read
+ * \param block_size    size of the decompressed blocks
+ */
+LineReader::LineReader(const std::string &filename, size_t block_size)
+    : source(openDecompressor(filename)),
+      block(block_size),
+      begin(0),
+      end(0),
+      eof(false)
+{
+}
+
+/** Read the lines of the data of a given decompressor.
+ *
+ * \param source        decompressor to take the data from
+ * \param block_size    size of the decompressed blocks
+ */
+LineReader::LineReader(std::unique_ptr<Decompressor> source, size_t block_size)
+    : source(std::move(source)),
+      block(block_size),
+      begin(0),
+      end(0),
+      eof(false)
+{
+}
+
+/// whether the file could be opened and read without errors
+bool LineReader::good() const
+{
+    return source->good();
+}
+
+/** Append the next block of data behind the incomplete last line.
+ *
+ * \return false, if the source is exhausted
+ */
+bool LineReader::refill()
+{
+    std::memmove(block.data(), block.data() + begin, end - begin);
+    end -= begin;
+    begin = 0;
+
+    // a single line does not fit into the block
+    if(end == block.size())
+        block.resize(2*block.size());
+
+    size_t n = source->read(block.data() + end, block.size() - end);
+    end += n;
+    if(!n)
+        eof = true;
+    return n;
+}
+
+/** Get the next line as view into the current block.
+ *
+ * Behaves like std::getline: the newline is not part of the line and
+ * a last line without newline is returned, too. The view is valid
+ * until the next call.
+ *
+ * \param line  receives the line
+ * \return false, if the end of the file is reached
+ */
+bool LineReader::getline(std::string_view &line)
+{
+    while(true)
+    {
+        const char *first = block.data() + begin;
+        const char *nl = static_cast<const char*>(std::memchr(first, '\n', end - begin));
+        if(nl)
+        {
+            line = std::string_view(first, nl - first);
+            begin = nl - block.data() + 1;
+            return true;
+        }
+
+        if(eof || !refill())
+        {
+            if(begin == end)
+                return false;
+            line = std::string_view(block.data() + begin, end - begin);
+            begin = end;
+            return true;
+        }
+    }
+}
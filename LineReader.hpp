@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+
+#include "Decompressor.hpp"
+
+/** Splits the data of a (compressed) file into lines.
+ *
+ * The data is decompressed in whole blocks into a large buffer and the
+ * lines are handed out as views into this buffer. Only a line crossing
+ * the end of a block is moved to the front of the buffer before the
+ * next block is appended.
+ */
+class LineReader
+{
+    protected:
+        std::unique_ptr<Decompressor> source;
+        std::vector<char> block;    ///< buffer for the decompressed data
+        size_t begin;               ///< start of the next line in block
+        size_t end;                 ///< end of the valid data in block
+        bool eof;                   ///< source is exhausted
+
+        bool refill();
+
+    public:
+        LineReader(const std::string &filename, size_t block_size=1<<22);
+        LineReader(std::unique_ptr<Decompressor> source, size_t block_size=1<<22);
+
+        bool good() const;
+        bool getline(std::string_view &line);
+};
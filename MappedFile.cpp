@@ -0,0 +1,103 @@
+#include "MappedFile.hpp"
+
+#include <algorithm>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "Logging.hpp"
+
+/** Map the given file into memory.
+ *
+ * The kernel is advised that the mapping will be read sequentially,
+ * such that it reads ahead aggressively and drops pages behind us.
+ * If the file can not be mapped, good() returns false.
+ */
+MappedFile::MappedFile(const std::string &filename)
+    : m_data(nullptr),
+      m_size(0),
+      m_good(false)
+{
+    int fd = open(filename.c_str(), O_RDONLY);
+    if(fd < 0)
+        return;
+
+    struct stat st;
+    if(fstat(fd, &st) == 0)
+    {
+        m_size = st.st_size;
+        if(m_size == 0)
+            m_good = true;
+        else
+        {
+            void *p = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if(p != MAP_FAILED)
+            {
+                madvise(p, m_size, MADV_SEQUENTIAL);
+                m_data = static_cast<const char*>(p);
+                m_good = true;
+            }
+            else
+            {
+                LOG(LOG_DEBUG) << "can not mmap " << filename;
+            }
+        }
+    }
+    // the mapping stays valid after closing the descriptor
+    close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+    if(m_data)
+        munmap(const_cast<char*>(m_data), m_size);
+}
+
+/// whether the file is mapped
+bool MappedFile::good() const
+{
+    return m_good;
+}
+
+/// the whole content of the file
+std::string_view MappedFile::view() const
+{
+    return std::string_view(m_data, m_size);
+}
+
+/// split the given memory, the lines are views into it
+LineSplitter::LineSplitter(std::string_view data)
+    : data(data),
+      pos(0)
+{
+}
+
+/** Get the next line as view into the memory.
+ *
+ * Behaves like std::getline: the newline is not part of the line and
+ * a last line without newline is returned, too.
+ *
+ * \param line  receives the line
+ * \return false, if the end of the memory is reached
+ */
+bool LineSplitter::getline(std::string_view &line)
+{
+    if(pos >= data.size())
+        return false;
+
+    size_t end = data.find('\n', pos);
+    if(end == std::string_view::npos)
+        end = data.size();
+
+    line = data.substr(pos, end - pos);
+    pos = end + 1;
+    return true;
+}
+
+/// offset of the next line
+size_t LineSplitter::tell() const
+{
+    return std::min(pos, data.size());
+}
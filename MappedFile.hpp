@@ -0,0 +1,43 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+/** Read-only memory mapping of a whole file.
+ *
+ * Used for uncompressed input files, whose lines can then be handed out
+ * as views into the mapping by a LineSplitter, without copying them into
+ * a buffer.
+ */
+class MappedFile
+{
+    protected:
+        const char *m_data;   ///< start of the mapping
+        size_t m_size;        ///< length of the file in bytes
+        bool m_good;          ///< whether the file could be mapped
+
+    public:
+        MappedFile(const std::string &filename);
+        ~MappedFile();
+
+        MappedFile(const MappedFile &) = delete;
+        MappedFile& operator=(const MappedFile &) = delete;
+
+        bool good() const;
+        std::string_view view() const;
+};
+
+/** Splits a range of memory into lines, handed out as views.
+ */
+class LineSplitter
+{
+    protected:
+        std::string_view data;  ///< memory to split
+        size_t pos;             ///< start of the next line
+
+    public:
+        LineSplitter(std::string_view data);
+
+        bool getline(std::string_view &line);
+        size_t tell() const;
+};
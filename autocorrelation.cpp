@@ -66,3 +66,45 @@ double autocorrelationTime(const std::vector<double> &timeseries)
 
     return tau;
 }
+
+/** Estimates the equilibration time of the given timeseries by the
+ *  marginal standard error rule (MSER-5).
+ *
+ *  The timeseries is averaged in batches of 5 samples. Of the first half
+ *  of the batches, those are discarded, which minimize the squared
+ *  standard error of the mean of the remaining batches
+ *
+ *  \f[ \frac{1}{(n-d)^2} \sum_{i=d}^{n} (x_i - \bar{x}_d)^2 \f]
+ *
+ *  \return number of samples to discard
+ */
+int equilibrationTime(const std::vector<double> &timeseries)
+{
+    const int batch = 5;
+    const int n = timeseries.size() / batch;
+    if(n < 2)
+        return 0;
+
+    std::vector<double> means(n, 0);
+    for(int i=0; i<n; ++i)
+    {
+        for(int j=0; j<batch; ++j)
+            means[i] += timeseries[i*batch + j];
+        means[i] /= batch;
+    }
+
+    // sums of the batch means and their squares from the back
+    double sum = 0;
+    double squares = 0;
+    std::vector<double> mser(n);
+    for(int d=n-1; d>=0; --d)
+    {
+        sum += means[d];
+        squares += means[d]*means[d];
+        const double m = n - d;
+        mser[d] = (squares - sum*sum/m) / (m*m);
+    }
+
+    const int d = std::min_element(mser.begin(), mser.begin() + n/2 + 1) - mser.begin();
+    return d * batch;
+}
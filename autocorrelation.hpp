@@ -8,3 +8,4 @@
 #include "stat.hpp"
 
 double autocorrelationTime(const std::vector<double> &timeseries);
+int equilibrationTime(const std::vector<double> &timeseries);
@@ -0,0 +1,87 @@
+/** Microbenchmark: filling one ConcurrentHistogram from all threads
+ * versus a CountHistogram per thread, which are merged by operator+=.
+ *
+ * This is the choice Ingestion::setConcurrent() makes for the parallel
+ * evaluation of a file. Run by `make bench`, optionally with the number
+ * of samples (default 2^25) as argument.
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <omp.h>
+
+#include "Histogram.hpp"
+#include "ConcurrentHistogram.hpp"
+
+/// seconds since start
+static double since(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv)
+{
+    const size_t num_samples = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1 << 25;
+    const int threads = omp_get_max_threads();
+
+    // like the decimated samples of a simulation, clustered in the middle of the range
+    std::vector<double> samples(num_samples);
+    #pragma omp parallel
+    {
+        std::mt19937 rng(omp_get_thread_num());
+        std::normal_distribution<double> normal(0.5, 0.15);
+        #pragma omp for
+        for(size_t i=0; i<num_samples; ++i)
+            samples[i] = normal(rng);
+    }
+    const size_t chunk = (num_samples + threads - 1) / threads;
+
+    std::cout << "# " << num_samples << " samples, " << threads << " threads\n";
+    std::cout << "# bins   copies [s]   concurrent [s]\n";
+    for(int num_bins : {100, 10000, 1000000})
+    {
+        const CountHistogram empty(num_bins, 0, 1);
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<CountHistogram> copies(threads, empty);
+        #pragma omp parallel for schedule(static,1)
+        for(int t=0; t<threads; ++t)
+        {
+            const size_t begin = std::min(num_samples, t * chunk);
+            const size_t end = std::min(num_samples, begin + chunk);
+            copies[t].add(samples.data() + begin, samples.data() + end);
+        }
+        CountHistogram merged = empty;
+        for(const auto &copy : copies)
+            merged += copy;
+        const double time_copies = since(start);
+
+        start = std::chrono::steady_clock::now();
+        ConcurrentHistogram shared(empty.layout());
+        #pragma omp parallel for schedule(static,1)
+        for(int t=0; t<threads; ++t)
+        {
+            const size_t begin = std::min(num_samples, t * chunk);
+            const size_t end = std::min(num_samples, begin + chunk);
+            shared.add(samples.data() + begin, samples.data() + end);
+        }
+        // like Ingestion, which adds the shared counts to its 64 bit histogram
+        WideCountHistogram concurrent(empty.layout());
+        shared.addTo(concurrent);
+        const double time_concurrent = since(start);
+
+        const WideCountHistogram wide(merged);
+        if(wide.get_data() != concurrent.get_data() || wide.window_begin() != concurrent.window_begin())
+        {
+            std::cerr << "counts differ for " << num_bins << " bins\n";
+            return 1;
+        }
+        std::cout << num_bins << "   " << time_copies << "   " << time_concurrent << "\n";
+    }
+
+    return 0;
+}
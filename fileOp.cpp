@@ -1,25 +1,70 @@
 #include "fileOp.hpp"
 
-/** Gets the n-th word in the given String.
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <stdexcept>
+
+#include "ColumnFile.hpp"
+#include "FrameFile.hpp"
+#include "GzipIndex.hpp"
+#include "HistogramCache.hpp"
+#include "Logging.hpp"
+
+#ifdef _OPENMP
+   #include <omp.h>
+#endif
+
+/** Gets the n-th word in the given line without copying it.
  *
  *  Words are separated by spaces, other whitespace does not work
  *
- * \param line  string, which should be splitted
+ * \param line  line, which should be splitted
  * \param n     which word
- * \return the n-th word as a string
+ * \return view of the n-th word, empty if there are not enough words
  */
-std::string getNthWord(const std::string &line, int n)
+std::string_view nthWord(std::string_view line, int n)
 {
-    std::string word;
-    std::stringstream ss;
-    ss.str(line);
-    int ctr = 0;
-    do
+    size_t begin = 0;
+    for(int ctr=0; ctr<n; ++ctr)
     {
-        std::getline(ss, word, ' ');
-        ++ctr;
-    } while(ctr <= n);
-    return word;
+        begin = line.find(' ', begin);
+        if(begin == std::string_view::npos)
+            return std::string_view();
+        ++begin;
+    }
+    size_t end = line.find(' ', begin);
+    if(end == std::string_view::npos)
+        end = line.size();
+    return line.substr(begin, end - begin);
+}
+
+/** Parses a number from a word, without allocations.
+ *
+ *  Behaves like std::stod: leading whitespace and a leading '+' are
+ *  accepted, trailing characters (e.g. '\\r') are ignored.
+ *
+ * \param word  string containing the number
+ * \return the parsed number
+ * \throws std::invalid_argument if no number could be parsed
+ * \throws std::out_of_range if the number is not representable
+ */
+double toDouble(std::string_view word)
+{
+    const char *begin = word.data();
+    const char *end = word.data() + word.size();
+    while(begin != end && std::isspace(static_cast<unsigned char>(*begin)))
+        ++begin;
+    if(begin != end && *begin == '+')
+        ++begin;
+
+    double number = 0;
+    auto result = std::from_chars(begin, end, number);
+    if(result.ec == std::errc::invalid_argument)
+        throw std::invalid_argument("toDouble: can not parse '" + std::string(word) + "'");
+    if(result.ec == std::errc::result_out_of_range)
+        throw std::out_of_range("toDouble: '" + std::string(word) + "' is out of range");
+    return number;
 }
 
 /** Tests if a given string ends with a given substring.
@@ -60,11 +105,17 @@ void write_out(std::string file, std::string text)
  */
 bool isHistogramFile(std::string filename)
 {
-    igzstream is(filename.c_str());
-    std::string item;
+    if(HistogramCache::isCacheFile(filename))
+        return true;
+    if(ColumnFile::isColumnFile(filename))
+        return false;
+
+    // the first block is enough to see a few lines
+    LineReader is(filename, 1<<16);
+    std::string_view item;
 
     int ctr = 0;
-    while(std::getline(is, item) && ctr < 5)
+    while(ctr < 5 && is.getline(item))
     {
         if(item.size() > 0 && item[0] != '#')
             ++ctr;
@@ -73,9 +124,674 @@ bool isHistogramFile(std::string filename)
     return ctr < 4;
 }
 
+/** Tests if the given file is gzip compressed, by its magic bytes.
+ */
+bool isGzipFile(const std::string &filename)
+{
+    return detectCompression(filename) == Compression::Gzip;
+}
+
 bool fileReadable(std::string filename)
 {
     std::ifstream is(filename.c_str());
     LOG(LOG_DEBUG) << filename << " " << is.good();
     return is.good();
 }
+
+/// skip empty lines and comments of a reader handing out views
+template<class T>
+static bool nextDataView(T &reader, std::string_view &line)
+{
+    while(reader.getline(line))
+        if(!line.empty() && line[0] != '#')
+            return true;
+    return false;
+}
+
+/** Get the next data line from memory, e.g., a mapped file.
+ *
+ *  The line is a view into the memory, the buffer is not used.
+ *
+ *  \param lines    splitter to get the line from
+ *  \param buffer   unused
+ *  \param line     view of the line inside the memory
+ *  \return false, if there are no more data lines
+ */
+bool getNextLine(LineSplitter &lines, std::string &buffer, std::string_view &line)
+{
+    (void) buffer;
+    return nextDataView(lines, line);
+}
+
+/** Get the next data line from a (compressed) file.
+ *
+ *  The line is a view into the current decompressed block, the buffer
+ *  is not used.
+ *
+ *  \param reader   reader to get the line from
+ *  \param buffer   unused
+ *  \param line     view of the line inside the block
+ *  \return false, if the file contains no more data lines
+ */
+bool getNextLine(LineReader &reader, std::string &buffer, std::string_view &line)
+{
+    (void) buffer;
+    return nextDataView(reader, line);
+}
+
+/// number of data lines in a block of memory
+static int64_t countDataLines(std::string_view block)
+{
+    LineSplitter lines(block);
+    std::string_view line;
+    int64_t ctr = 0;
+    while(nextDataView(lines, line))
+        ++ctr;
+    return ctr;
+}
+
+/// number of threads used to read a single file
+static int numThreads()
+{
+    #ifdef _OPENMP
+    return omp_get_max_threads();
+    #else
+    return 1;
+    #endif
+}
+
+/// feed one data line into the ingestions of the given columns
+static void feedLine(std::string_view line, std::vector<Ingestion> &ingestions, const std::vector<int> &columns)
+{
+    for(size_t k=0; k<ingestions.size(); ++k)
+        if(ingestions[k].next())
+            ingestions[k].add(toDouble(nthWord(line, columns[k])));
+}
+
+/// whether the steps of all ingestions are known
+static bool stepsKnown(const std::vector<Ingestion> &ingestions)
+{
+    for(const auto &ingestion : ingestions)
+        if(!ingestion.stepKnown())
+            return false;
+    return true;
+}
+
+static void finish(std::vector<Ingestion> &ingestions)
+{
+    for(auto &ingestion : ingestions)
+        ingestion.finish();
+}
+
+/** Evaluate segments of a file in parallel.
+ *
+ *  Every segment is evaluated into ingestions forked from the given
+ *  ones, which know the number of data lines in front of the segment and
+ *  can therefore apply skip and step exactly as a serial read. The
+ *  segments are processed in batches of one segment per thread and are
+ *  merged in order, such that the result equals the one of a serial read.
+ *  The histograms are either merged or filled concurrently, see
+ *  Ingestion::share().
+ *
+ *  \param ingestions   evaluations to merge into, the steps need to be known
+ *  \param first_lines  number of data lines in front of every segment
+ *  \param begin        first segment to evaluate
+ *  \param scan         scan(k, parts) feeds the data lines of segment k into parts
+ */
+template<class F>
+static void ingestSegments(std::vector<Ingestion> &ingestions, const std::vector<int64_t> &first_lines, size_t begin, F scan)
+{
+    const size_t n = numThreads();
+    for(auto &ingestion : ingestions)
+        ingestion.share();
+    for(size_t batch=begin; batch<first_lines.size(); batch+=n)
+    {
+        const size_t end = std::min(first_lines.size(), batch + n);
+        std::vector<std::vector<Ingestion>> parts(end - batch);
+
+        #pragma omp parallel for schedule(dynamic,1)
+        for(size_t k=batch; k<end; ++k)
+        {
+            for(const auto &ingestion : ingestions)
+                parts[k-batch].push_back(ingestion.fork(first_lines[k]));
+            scan(k, parts[k-batch]);
+        }
+
+        for(const auto &part : parts)
+            for(size_t j=0; j<ingestions.size(); ++j)
+                ingestions[j].merge(part[j]);
+    }
+}
+
+/// feed all data lines of a line source into the ingestions
+template<class T>
+static void scanLines(T &source, std::vector<Ingestion> &ingestions, const std::vector<int> &columns)
+{
+    std::string buffer;
+    std::string_view line;
+    while(getNextLine(source, buffer, line))
+        feedLine(line, ingestions, columns);
+}
+
+/// feed data lines of a line source into the ingestions, until all steps are known
+template<class T>
+static void scanHead(T &source, std::vector<Ingestion> &ingestions, const std::vector<int> &columns)
+{
+    std::string buffer;
+    std::string_view line;
+    while(!stepsKnown(ingestions) && getNextLine(source, buffer, line))
+        feedLine(line, ingestions, columns);
+}
+
+/// split a text into n ranges at line boundaries, range k is [bounds[k], bounds[k+1])
+static std::vector<size_t> lineBounds(std::string_view all, int n)
+{
+    std::vector<size_t> bounds(n+1, all.size());
+    bounds[0] = 0;
+    for(int k=1; k<n; ++k)
+    {
+        size_t pos = std::max(bounds[k-1], all.size() / n * k);
+        if(pos > 0 && pos < all.size() && all[pos-1] != '\n')
+        {
+            pos = all.find('\n', pos);
+            pos = pos == std::string_view::npos ? all.size() : pos + 1;
+        }
+        bounds[k] = pos;
+    }
+    return bounds;
+}
+
+/** Index the data lines of a text, using all threads.
+ *
+ *  Every range of lineBounds() gets a point at every span-th of its data
+ *  lines, such that the points are at most span data lines apart.
+ *
+ *  \param all         complete text of the file
+ *  \param complete    whether all ends with a newline
+ *  \param stats       statistics receiving the index
+ */
+static void indexText(std::string_view all, bool complete, FileStatistics &stats)
+{
+    const int n = numThreads();
+    const std::vector<size_t> bounds = lineBounds(all, n);
+    const int64_t span = stats.span();
+
+    std::vector<std::vector<FileStatistics::Point>> points(n);
+    std::vector<int64_t> first_lines(n+1, 0);
+    #pragma omp parallel for schedule(static,1)
+    for(int k=0; k<n; ++k)
+    {
+        const std::string_view range = all.substr(bounds[k], bounds[k+1] - bounds[k]);
+        LineSplitter lines(range);
+        std::string_view line;
+        int64_t ctr = 0;
+        while(nextDataView(lines, line))
+        {
+            if(ctr % span == 0)
+                points[k].push_back(FileStatistics::Point{bounds[k] + (line.data() - range.data()), ctr});
+            ++ctr;
+        }
+        first_lines[k+1] = ctr;
+    }
+
+    std::vector<FileStatistics::Point> index;
+    for(int k=0; k<n; ++k)
+    {
+        first_lines[k+1] += first_lines[k];
+        for(auto p : points[k])
+        {
+            p.lines += first_lines[k];
+            index.push_back(p);
+        }
+    }
+    stats.setIndex(std::move(index), first_lines[n], complete);
+}
+
+/** Start after the data lines, which are skipped by all ingestions, by
+ *  the index of the statistics, if it is known.
+ *
+ *  \return offset to start reading from, the ingestions are resumed after the lines in front of it
+ */
+static uint64_t seekSkipped(const std::string &filename, const FileStatistics *stats, std::vector<Ingestion> &ingestions)
+{
+    if(!stats || !stats->indexed())
+        return 0;
+
+    int64_t skip = ingestions.front().skipped();
+    for(const auto &ingestion : ingestions)
+    {
+        if(ingestion.lines())
+            return 0;
+        skip = std::min(skip, ingestion.skipped());
+    }
+
+    const FileStatistics::Point start = stats->seek(skip);
+    if(!start.lines)
+        return 0;
+
+    for(auto &ingestion : ingestions)
+        ingestion.resume(start.lines);
+    LOG(LOG_DEBUG) << "seek over " << start.lines << " skipped lines of " << filename;
+    return start.offset;
+}
+
+/** Feed the data lines of a text into ingestions, using all threads.
+ *
+ *  The text is split into one range per thread, aligned to the line
+ *  boundaries. First the data lines of every range are counted, such
+ *  that every range knows the index of its first line. Then the ranges
+ *  are evaluated by ingestSegments().
+ *
+ *  The steps need to be known.
+ */
+static void ingestText(std::string_view all, std::vector<Ingestion> &ingestions, const std::vector<int> &columns)
+{
+    const int n = numThreads();
+    const std::vector<size_t> bounds = lineBounds(all, n);
+
+    std::vector<int64_t> first_lines(n+1, ingestions.front().lines());
+    #pragma omp parallel for schedule(static,1)
+    for(int k=0; k<n; ++k)
+        first_lines[k+1] = countDataLines(all.substr(bounds[k], bounds[k+1] - bounds[k]));
+    for(int k=0; k<n; ++k)
+        first_lines[k+1] += first_lines[k];
+    first_lines.pop_back();
+
+    ingestSegments(ingestions, first_lines, 0, [&](size_t k, std::vector<Ingestion> &parts)
+    {
+        LineSplitter lines(all.substr(bounds[k], bounds[k+1] - bounds[k]));
+        scanLines(lines, parts, columns);
+    });
+}
+
+/** Feed the data lines at the beginning of a text into ingestions,
+ *  until all steps are known.
+ *
+ *  \return the rest of the text
+ */
+static std::string_view ingestHead(std::string_view all, std::vector<Ingestion> &ingestions, const std::vector<int> &columns)
+{
+    LineSplitter head(all);
+    scanHead(head, ingestions, columns);
+    return all.substr(head.tell());
+}
+
+/** Feed a memory mapped text into ingestions, using all threads.
+ *
+ *  If the steps are not given, they are estimated serially from the
+ *  beginning of the text first.
+ */
+static void ingestParallel(std::string_view text, std::vector<Ingestion> &ingestions, const std::vector<int> &columns)
+{
+    const std::string_view rest = ingestHead(text, ingestions, columns);
+    if(stepsKnown(ingestions))
+        ingestText(rest, ingestions, columns);
+    finish(ingestions);
+}
+
+/** Feed a zstd or lz4 file into ingestions, using all threads.
+ *
+ *  The frames are decoded in parallel in batches of at least one frame
+ *  per thread and 64 MiB, directly into their place in one buffer, whose
+ *  complete lines are then evaluated by ingestText(). A line crossing the
+ *  end of a batch is moved to the front of the next one.
+ */
+static void ingestFrames(const std::string &filename, const FrameFile &file, std::vector<Ingestion> &ingestions, const std::vector<int> &columns)
+{
+    const auto &frames = file.frames();
+    const size_t n = numThreads();
+    LOG(LOG_DEBUG) << "decode " << frames.size() << " frames of " << filename << " in parallel";
+
+    std::vector<char> buffer;
+    std::string carry;
+    bool failed = false;
+    for(size_t begin=0; begin<frames.size() && !failed; )
+    {
+        std::vector<size_t> offsets;
+        size_t size = carry.size();
+        size_t end = begin;
+        while(end < frames.size() && (end - begin < n || size < 1<<26))
+        {
+            offsets.push_back(size);
+            size += frames[end].content_size;
+            ++end;
+        }
+
+        if(buffer.size() < size)
+            buffer.resize(size);
+        std::copy(carry.begin(), carry.end(), buffer.begin());
+
+        std::vector<char> ok(end - begin);
+        #pragma omp parallel for schedule(dynamic,1)
+        for(size_t k=begin; k<end; ++k)
+            ok[k-begin] = file.decode(frames[k], buffer.data() + offsets[k-begin]);
+
+        // like a truncated file: use everything in front of a corrupt frame
+        for(size_t k=begin; k<end; ++k)
+            if(!ok[k-begin])
+            {
+                LOG(LOG_ERROR) << "error while decompressing frame " << k << " of " << filename;
+                size = offsets[k-begin];
+                failed = true;
+                break;
+            }
+        begin = end;
+
+        std::string_view text(buffer.data(), size);
+        size_t complete = text.size();
+        if(begin < frames.size() && !failed)
+            complete = text.rfind('\n') + 1;
+
+        std::string_view rest = ingestHead(text.substr(0, complete), ingestions, columns);
+        if(stepsKnown(ingestions))
+            ingestText(rest, ingestions, columns);
+        carry.assign(text.substr(complete));
+    }
+    finish(ingestions);
+}
+
+/** Feed a gzip file into ingestions, using all threads.
+ *
+ *  The segments between the seek points of the index are inflated and
+ *  evaluated in parallel by ingestSegments().
+ *
+ *  If the steps are not given, they are estimated serially from the
+ *  beginning of the file first, the serial read then continues up to
+ *  the next seek point.
+ */
+static void ingestIndexed(const std::string &filename, const GzipIndex &index, std::vector<Ingestion> &ingestions, const std::vector<int> &columns)
+{
+    const auto &points = index.points();
+
+    // segment k starts at points[k-1]
+    size_t begin = 0;
+    if(!stepsKnown(ingestions))
+    {
+        LineReader reader(filename);
+        scanHead(reader, ingestions, columns);
+
+        const int64_t lines = ingestions.front().lines();
+        while(begin < points.size() && points[begin].lines < lines)
+            ++begin;
+
+        // no seek point left, or the file ended before the steps were known
+        if(begin == points.size() || !stepsKnown(ingestions))
+        {
+            scanLines(reader, ingestions, columns);
+            finish(ingestions);
+            return;
+        }
+
+        std::string buffer;
+        std::string_view line;
+        while(ingestions.front().lines() < points[begin].lines && getNextLine(reader, buffer, line))
+            feedLine(line, ingestions, columns);
+        ++begin;
+    }
+
+    std::vector<int64_t> first_lines(points.size() + 1, 0);
+    for(size_t k=1; k<first_lines.size(); ++k)
+        first_lines[k] = points[k-1].lines;
+
+    ingestSegments(ingestions, first_lines, begin, [&](size_t k, std::vector<Ingestion> &parts)
+    {
+        LineReader reader(std::unique_ptr<Decompressor>(new GzipSegmentDecompressor(filename, index, k)));
+        scanLines(reader, parts, columns);
+    });
+    finish(ingestions);
+}
+
+/** Feed the values of one column of a column file into an ingestion.
+ *
+ *  Every row is a data line. Once the step is known, the rows are split
+ *  evenly among the threads, if parallel.
+ */
+template<class V>
+static void ingestValues(const V *values, size_t rows, Ingestion &ingestion, bool parallel)
+{
+    size_t row = 0;
+    for(; row < rows && !ingestion.stepKnown(); ++row)
+        if(ingestion.next())
+            ingestion.add(values[row]);
+
+    if(parallel && row < rows)
+    {
+        const size_t n = numThreads();
+        const size_t chunk = (rows - row + n - 1) / n;
+        std::vector<int64_t> first_lines;
+        for(size_t begin = row; begin < rows; begin += chunk)
+            first_lines.push_back(ingestion.lines() + (begin - row));
+
+        std::vector<Ingestion> ingestions(1, std::move(ingestion));
+        ingestSegments(ingestions, first_lines, 0, [&](size_t k, std::vector<Ingestion> &parts)
+        {
+            const size_t begin = row + k * chunk;
+            const size_t end = std::min(rows, begin + chunk);
+            for(size_t i=begin; i<end; ++i)
+                if(parts[0].next())
+                    parts[0].add(values[i]);
+        });
+        ingestion = std::move(ingestions[0]);
+    }
+    else
+    {
+        for(; row < rows; ++row)
+            if(ingestion.next())
+                ingestion.add(values[row]);
+    }
+    ingestion.finish();
+}
+
+/// feed the columns of a column file into ingestions, one column after another
+static void ingestColumns(const std::string &filename, std::vector<Ingestion> &ingestions, const std::vector<int> &columns, bool parallel)
+{
+    ColumnFile file(filename);
+    for(size_t k=0; k<ingestions.size(); ++k)
+    {
+        const int column = columns[k];
+        if(!file.good() || column >= file.columns())
+        {
+            LOG(LOG_ERROR) << "there is no column " << column << " in " << filename;
+            ingestions[k].finish();
+        }
+        else if(file.dtype() == ColumnFile::FLOAT32)
+            ingestValues(static_cast<const float*>(file.data(column)), file.rows(), ingestions[k], parallel);
+        else
+            ingestValues(static_cast<const double*>(file.data(column)), file.rows(), ingestions[k], parallel);
+    }
+}
+
+/** Whether ingestFile can read the file with multiple threads.
+ *
+ *  This is the case for uncompressed files, which are memory mapped,
+ *  for gzip files with an up to date GzipIndex and for zstd and lz4
+ *  files consisting of several frames of known size.
+ */
+bool canSplit(const std::string &filename)
+{
+    switch(detectCompression(filename))
+    {
+        case Compression::None:
+            // uncompressed text or column file
+            return true;
+        case Compression::Gzip:
+            return GzipIndex::available(filename);
+        default:
+        {
+            FrameFile file(filename);
+            return file.good() && file.frames().size() > 1;
+        }
+    }
+}
+
+/** Whether data appended to the file can be evaluated separately by
+ *  ingestAppended(), which is the case for uncompressed text files.
+ */
+bool canAppend(const std::string &filename)
+{
+    return !ColumnFile::isColumnFile(filename) && detectCompression(filename) == Compression::None;
+}
+
+/** Feed the complete data lines of an uncompressed text file from a
+ *  byte offset on into ingestions.
+ *
+ *  If the file is read from its beginning, all of it is evaluated, like
+ *  by ingestFile(). If it does not end with a newline, it can not be
+ *  continued later, since its last line may still be incomplete. When
+ *  continuing from offset, a last line without a newline is probably
+ *  still being written, it is left for the next call. The ingestions
+ *  need to continue after the lines in front of offset, see
+ *  Ingestion::resume().
+ *
+ *  If the file is read from its beginning, the skipped lines are sought
+ *  over by the index of the statistics, which is built, if unknown.
+ *
+ *  \param filename     file to read from
+ *  \param offset       start of the data, which was not evaluated yet
+ *  \param ingestions   one evaluation per column to feed the data lines into
+ *  \param columns      in which columns of the file is the data
+ *  \param parallel     use all threads for this file
+ *  \param stats        statistics of the file, optional
+ *  \return offset after the last complete line, to continue from next
+ *          time, 0 if the file can not be continued
+ */
+uint64_t ingestAppended(const std::string &filename, uint64_t offset, std::vector<Ingestion> &ingestions, const std::vector<int> &columns, bool parallel, FileStatistics *stats)
+{
+    MappedFile file(filename);
+    const std::string_view all = file.view();
+    const bool resuming = offset;
+    const bool complete = all.empty() || all.back() == '\n';
+    // npos + 1 == 0, if there is no complete line
+    const uint64_t end = resuming ? all.rfind('\n') + 1 : all.size();
+    if(!file.good() || end < offset)
+    {
+        LOG(LOG_ERROR) << "can not read " << filename << " from byte " << offset;
+        finish(ingestions);
+        return offset;
+    }
+
+    if(!resuming)
+    {
+        if(stats && !stats->indexed())
+            indexText(all, complete, *stats);
+        offset = seekSkipped(filename, stats, ingestions);
+    }
+
+    const std::string_view text = all.substr(offset, end - offset);
+    if(parallel)
+    {
+        const std::string_view rest = ingestHead(text, ingestions, columns);
+        if(stepsKnown(ingestions))
+            ingestText(rest, ingestions, columns);
+    }
+    else
+    {
+        LineSplitter lines(text);
+        scanLines(lines, ingestions, columns);
+    }
+    finish(ingestions);
+
+    // a partial last line was evaluated, it can not be continued
+    if(!resuming && !complete)
+        return 0;
+    return end;
+}
+
+/** Feed several columns of a data file into ingestions, in a single pass.
+ *
+ *  Uncompressed files are memory mapped, compressed files are
+ *  decompressed blockwise by a LineReader. While reading a gzip file
+ *  serially, an index of seek points is built and saved next to it
+ *  (or in the cache directory), such that later runs can read it in
+ *  parallel. The frames of zstd and
+ *  lz4 files are decoded in parallel, if possible. The values of column
+ *  files are read directly from the mapping.
+ *
+ *  The skipped lines of uncompressed files are sought over by the index
+ *  of the statistics, which is built, if unknown.
+ *
+ *  \param filename     file to read from
+ *  \param ingestions   one evaluation per column to feed the data lines into
+ *  \param columns      in which columns of the file is the data
+ *  \param parallel     use all threads for this file, if canSplit() it
+ *  \param stats        statistics of the file, optional
+ */
+void ingestFile(const std::string &filename, std::vector<Ingestion> &ingestions, const std::vector<int> &columns, bool parallel, FileStatistics *stats)
+{
+    if(ColumnFile::isColumnFile(filename))
+    {
+        ingestColumns(filename, ingestions, columns, parallel);
+        return;
+    }
+
+    const Compression format = detectCompression(filename);
+    if(format == Compression::None)
+    {
+        MappedFile file(filename);
+        if(file.good())
+        {
+            const std::string_view all = file.view();
+            if(stats && !stats->indexed())
+                indexText(all, all.empty() || all.back() == '\n', *stats);
+            const std::string_view text = all.substr(seekSkipped(filename, stats, ingestions));
+
+            if(parallel)
+                ingestParallel(text, ingestions, columns);
+            else
+            {
+                LineSplitter lines(text);
+                scanLines(lines, ingestions, columns);
+                finish(ingestions);
+            }
+            return;
+        }
+    }
+    else if(format == Compression::Gzip)
+    {
+        GzipIndex index;
+        const bool indexed = index.load(filename);
+        if(parallel && indexed)
+        {
+            ingestIndexed(filename, index, ingestions, columns);
+            return;
+        }
+
+        GzipDecompressor *gz = new GzipDecompressor(filename);
+        if(!indexed)
+            gz->recordIndex(&index);
+        LineReader reader(PrefetchDecompressor::wrap(std::unique_ptr<Decompressor>(gz)));
+        scanLines(reader, ingestions, columns);
+        finish(ingestions);
+
+        if(!indexed)
+            index.save(filename);
+        return;
+    }
+    else if(parallel)
+    {
+        FrameFile file(filename);
+        if(file.good())
+        {
+            ingestFrames(filename, file, ingestions, columns);
+            return;
+        }
+    }
+
+    LineReader reader(PrefetchDecompressor::wrap(openDecompressor(filename)));
+    scanLines(reader, ingestions, columns);
+    finish(ingestions);
+}
+
+/** Feed one column of a data file into an ingestion.
+ *
+ *  \param filename     file to read from
+ *  \param ingestion    evaluation to feed the data lines into
+ *  \param column       in which column of the file is the data
+ *  \param parallel     use all threads for this file, if canSplit() it
+ */
+void ingestFile(const std::string &filename, Ingestion &ingestion, int column, bool parallel)
+{
+    std::vector<Ingestion> ingestions(1, std::move(ingestion));
+    ingestFile(filename, ingestions, std::vector<int>(1, column), parallel);
+    ingestion = std::move(ingestions[0]);
+}
@@ -2,37 +2,106 @@
 
 #include <iostream>
 #include <fstream>
-
-#include "gzstream/gzstream.h"
+#include <string_view>
 
 #include "Histogram.hpp"
+#include "Ingestion.hpp"
+#include "FileStatistics.hpp"
+#include "MappedFile.hpp"
+#include "LineReader.hpp"
 #include "autocorrelation.hpp"
 
 bool has_suffix(const std::string &str, const std::string &suffix);
 
 void write_out(std::string file, std::string text);
-std::string getNthWord(const std::string &line, int n);
+std::string_view nthWord(std::string_view line, int n);
+double toDouble(std::string_view word);
 
 bool isHistogramFile(std::string filename);
+bool isGzipFile(const std::string &filename);
 bool fileReadable(std::string filename);
 
-/** Get the next line from an input stream.
+/** Get the next data line from an input stream.
+ *
+ *  Empty lines and comments (starting with '#') are skipped. The line
+ *  buffer is reused, such that no allocation happens once it is large
+ *  enough to hold the longest line.
  *
  *  \tparam T           type of the input stram
  *  \param instream     reference to the input stream to read from
+ *  \param buffer       buffer receiving the line
+ *  \param line         view of the line inside the buffer
+ *  \return false, if the stream contains no more data lines
  */
 template<class T>
-std::string getNextLine(T &instream)
+bool getNextLine(T &instream, std::string &buffer, std::string_view &line)
 {
-    std::string line;
-    while(instream.good())
-    {
-        std::getline(instream, line);
-        if(line.empty() || line[0] == '#')
-            continue;
-        break;
-    }
-    return line;
+    while(std::getline(instream, buffer))
+        if(!buffer.empty() && buffer[0] != '#')
+        {
+            line = buffer;
+            return true;
+        }
+    return false;
+}
+
+bool getNextLine(LineSplitter &lines, std::string &buffer, std::string_view &line);
+bool getNextLine(LineReader &reader, std::string &buffer, std::string_view &line);
+
+/** Scans the data lines of an input stream for the values of one column.
+ *
+ *  The column is located and parsed in place, only for lines whose
+ *  value is actually requested, so reading a sample does not allocate.
+ *  For a LineSplitter or a LineReader the lines are not even copied.
+ *
+ *  \tparam T   type of the input stram
+ */
+template<class T>
+class ColumnScanner
+{
+    public:
+        ColumnScanner(T &instream, int column)
+            : instream(instream),
+              column(column)
+        {
+        }
+
+        /// advance to the next data line, false at the end of the stream
+        bool next()
+        {
+            return getNextLine(instream, buffer, line);
+        }
+
+        /// value in the column of the current line
+        double value() const
+        {
+            return toDouble(nthWord(line, column));
+        }
+
+    protected:
+        T &instream;
+        int column;
+        std::string buffer;
+        std::string_view line;
+};
+
+/** Feed one column of an input stream (of string) into an ingestion.
+ *
+ *  Only the values of lines the ingestion asks for are parsed.
+ *
+ *  \tparam T           type of the input stram
+ *  \param instream     reference to the input stream to read from
+ *  \param ingestion    evaluation to feed the data lines into
+ *  \param column       in which column of the input stream is the data
+ */
+template<class T>
+void ingestStream(T &instream, Ingestion &ingestion, int column=0)
+{
+    ColumnScanner<T> scanner(instream, column);
+    while(scanner.next())
+        if(ingestion.next())
+            ingestion.add(scanner.value());
+    ingestion.finish();
 }
 
 /** Create a histogram from an input stream (of string).
@@ -44,61 +113,32 @@ std::string getNextLine(T &instream)
  *  \param upper        upper border of the histogram
  *  \param column       in which column of the input stream is the data
  *  \param skip         skip the first lines of the input stream
+ *  \param step         read only every nth line, 0 to estimate it from tau
  */
 template<class T>
 Histogram histogramFromStream(T &instream, int num_bins, double lower, double upper, int column=0, int skip=0, int step=1)
 {
-    Histogram h(num_bins, lower, upper);
-
-    int ctr = 0;
-    while(instream.good())
-    {
-        std::string line = getNextLine(instream);
-        if(line.empty() || line[0] == '#')
-            continue;
-        if(ctr++ < skip)
-            continue;
-        if((ctr-skip) % step)
-            continue;
-        std::string word = getNthWord(line, column);
-
-        double number = std::stod(word);
-        h.add(number);
-    }
-    return h;
+    Ingestion ingestion(skip, step);
+    ingestion.bin(num_bins, lower, upper);
+    ingestStream(instream, ingestion, column);
+    return Histogram(ingestion.histogram());
 }
 
 /** Vector from an input stream (of string).
  *
  *  \tparam T           type of the input stram
  *  \param instream     reference to the input stream to read from
- *  \param num_bins     how many bins should the histogram have
- *  \param lower        lower border of the histogram
- *  \param upper        upper border of the histogram
  *  \param column       in which column of the input stream is the data
  *  \param skip         skip the first lines of the input stream
+ *  \param step         read only every nth line, 0 to estimate it from tau
  */
 template<class T>
 std::vector<double> vectorFromStream(T &instream, int column=0, int skip=0, int step=1)
 {
-    std::vector<double> v;
-
-    int ctr = 0;
-    while(instream.good())
-    {
-        std::string line = getNextLine(instream);
-        if(line.empty() || line[0] == '#')
-            continue;
-        if(ctr++ < skip)
-            continue;
-        if((ctr-skip) % step)
-            continue;
-        std::string word = getNthWord(line, column);
-
-        double number = std::stod(word);
-        v.push_back(number);
-    }
-    return v;
+    Ingestion ingestion(skip, step);
+    ingestion.keepSamples();
+    ingestStream(instream, ingestion, column);
+    return ingestion.samples();
 }
 
 /** Obtain the largest and smallest values from an input stream (of string).
@@ -111,64 +151,36 @@ std::vector<double> vectorFromStream(T &instream, int column=0, int skip=0, int
  *  \param          skip         skip the first lines of the input stream
  */
 template<class T>
-void bordersFromStream(T &instream, double &lower, double &upper, int column=0, int skip=0, int step=1)
+void bordersFromStream(T &instream, double &lower, double &upper, int column=0, int skip=0)
 {
-    int ctr = 0;
-    while(instream.good())
-    {
-        std::string line = getNextLine(instream);
-        if(line.empty() || line[0] == '#')
-            continue;
-        if(ctr++ < skip)
-            continue;
-        if((ctr-skip) % step)
-            continue;
-        std::string word = getNthWord(line, column);
-
-        double number = std::stod(word);
-
-        if(number < lower)
-            lower = number;
-        if(number > upper)
-            upper = number;
-    }
-    lower -= 0.05*(upper-lower);
-    upper += 0.05*(upper-lower);
+    Ingestion ingestion(skip, 1);
+    ingestion.trackRange();
+    ingestStream(instream, ingestion, column);
+    ingestion.range(lower, upper);
 }
 
+/** Estimate the autocorrelation time from the beginning of an input stream.
+ *
+ *  Reads only as many lines as needed for a converged estimate.
+ *
+ *  \tparam T           type of the input stram
+ *  \param instream     reference to the input stream to read from
+ *  \param column       in which column of the input stream is the data
+ *  \param skip         skip the first lines of the input stream
+ */
 template<class T>
 double tauFromStream(T &instream, int column=0, int skip=0)
 {
-    int ctr = 0;
-    std::vector<double> sample;
-    // use this many samples to determine the autocorrelation time
-    int num_samples = 64;
-    //~ int num_samples = 256;
-    //~ int num_samples = 1024;
-    //~ int num_samples = 512;
-    double tau = 1;
-    while(instream.good())
-    {
-        std::string line = getNextLine(instream);
-        if(ctr++ < skip)
-            continue;
-        if(line.empty())
-            continue;
-        std::string word = getNthWord(line, column);
-
-        double number = std::stod(word);
-        sample.push_back(number);
-
-        if(ctr-skip == num_samples)
-        {
-            tau = autocorrelationTime(sample);
-            // if the autocorrelation time is of the same order of the
-            // number of samples, try again with more samples
-            if(tau > num_samples/100.)
-                num_samples *= 2;
-            else
-                break;
-        }
-    }
-    return tau;
+    Ingestion ingestion(skip);
+    ColumnScanner<T> scanner(instream, column);
+    while(!ingestion.stepKnown() && scanner.next())
+        if(ingestion.next())
+            ingestion.add(scanner.value());
+    return ingestion.tau();
 }
+
+bool canSplit(const std::string &filename);
+bool canAppend(const std::string &filename);
+uint64_t ingestAppended(const std::string &filename, uint64_t offset, std::vector<Ingestion> &ingestions, const std::vector<int> &columns, bool parallel=false, FileStatistics *stats=nullptr);
+void ingestFile(const std::string &filename, std::vector<Ingestion> &ingestions, const std::vector<int> &columns, bool parallel=false, FileStatistics *stats=nullptr);
+void ingestFile(const std::string &filename, Ingestion &ingestion, int column=0, bool parallel=false);
@@ -16,14 +16,31 @@ double correct_bias(double s, double theta, double p_theta)
     return s/theta + std::log(p_theta);
 }
 
-void write_to_stream(std::ofstream &oss, const std::vector<double> &centers, const std::vector<double> &data)
+/** Corrected data of one histogram.
+ *
+ * Only the window of bins stored by the histogram is kept, the values
+ * of the empty bins outside are calculated on demand. They are never
+ * finite, such that they do not contribute to the output.
+ */
+struct Corrected
 {
-    for(size_t j=0; j<data.size(); ++j)
-        if(std::isfinite(data[j]))
-            oss << centers[j] << " " << data[j] << "\n";
-    oss << "\n";
-}
-
+    int first;                          ///< first stored bin
+    std::vector<double> values;         ///< corrected values of the stored bins
+    bool weighted;
+    double theta;
+    double shift;                       ///< Z, which is added to all bins
+    const std::vector<double> *centers;
+
+    /// corrected value of bin j
+    double operator[](int j) const
+    {
+        if(j >= first && j < first + static_cast<int>(values.size()))
+            return values[j - first];
+        if(weighted)
+            return correct_bias((*centers)[j], theta, 0) + shift;
+        return std::nan("") + shift;
+    }
+};
 
 /** Determine the normalization constants Z
  *
@@ -36,29 +53,39 @@ void write_to_stream(std::ofstream &oss, const std::vector<double> &centers, con
  * \param weighted should the means be weighted
  * \param thetas used temperatures, only for user output
  */
-std::vector<double> determineZ(const std::vector<Histogram> &hists, const std::vector<std::vector<double>> &corrected_data, int threshold, bool weighted, const std::vector<double> &thetas)
+std::vector<double> determineZ(const std::vector<Histogram> &hists, const std::vector<Corrected> &corrected_data, int threshold, bool weighted, const std::vector<double> &thetas)
 {
     std::vector<double> Zs(hists.size(), 0);
     for(size_t i=1; i<hists.size(); ++i)
     {
         // TODO: do not only use successive histograms for glueing, but all 
-        const auto &count1 = hists[i-1].get_data();
-        const auto &count2 = hists[i].get_data();
-        const auto &data1 = corrected_data[i-1];
-        const auto &data2 = corrected_data[i];
+        const Histogram &count1 = hists[i-1];
+        const Histogram &count2 = hists[i];
+        const Corrected &data1 = corrected_data[i-1];
+        const Corrected &data2 = corrected_data[i];
+
+        // empty bins are above a negative threshold, otherwise only the
+        // overlap of the stored windows can contribute
+        int begin = 0;
+        int end = hists[i].get_num_bins();
+        if(threshold >= 0)
+        {
+            begin = std::max(count1.window_begin(), count2.window_begin());
+            end = std::min(count1.window_end(), count2.window_end());
+        }
 
         std::vector<double> Z;
         std::vector<double> weight; // how to weight the data, to get the mean of Z
         // get region of overlap
         // assumes temperatures are ordered
-        for(size_t j=0; j<data1.size(); ++j)
+        for(int j=begin; j<end; ++j)
         {
-            if(count1[j] > threshold && count2[j] > threshold)
+            if(count1.at(j) > threshold && count2.at(j) > threshold)
             {
                 Z.push_back(data1[j]-data2[j]);
                 // weight the Z: more weight, if both datasets have many entries
                 if(weighted)
-                    weight.push_back(std::min(hists[i].get_data()[j], hists[i].get_data()[j]));
+                    weight.push_back(std::min(hists[i].at(j), hists[i].at(j)));
                 else // equal weight, if data originates from WL
                     weight.push_back(1);
             }
@@ -89,84 +116,73 @@ std::vector<double> determineZ(const std::vector<Histogram> &hists, const std::v
  *
  *  The histograms need to have the same borders.
  *
+ *  Only the stored windows of the histograms are corrected, such that
+ *  the memory needed does not grow with the number of bins times the
+ *  number of histograms.
+ *
  *  \param hists        vector of histograms to glue
  *  \param thetas       temperatures for each histogram such that hists[i] is sampled at thetas[i]
  *  \param threshold    how many entries should a bin have to be considered for determination of \f$ Z_\Theta \f$
+ *  \param diagnostics  receives the intermediate results
  */
-Histogram glueHistograms(const std::vector<Histogram> &hists, const std::vector<double> thetas, int threshold, const GnuplotData gp)
+Histogram glueHistograms(const std::vector<Histogram> &hists, const std::vector<double> &thetas, int threshold, GlueDiagnostics &diagnostics)
 {
-    std::string histname = gp.hist_name;
-    std::string correctedname = gp.corrected_name;
-    std::string gluedname = gp.glued_name;
-    std::string finishedname = gp.finished_name;
-    std::ofstream osHist(histname);
-    std::ofstream osCorrected(correctedname);
-    std::ofstream osGlued(gluedname);
-    std::ofstream osFinished(finishedname);
-    for(auto &h : hists)
-        osHist << h.ascii_table() << "\n";
+    diagnostics.histograms(hists);
 
     // perform weighting only for temperature based sheme
     const bool weighted = !thetas.empty();
 
     // centers of all histograms should be equal
     const auto &centers = hists[0].centers();
+    const int num_bins = hists[0].get_num_bins();
 
-    std::vector<std::vector<double>> corrected_data;
-    // if no temperatures are given, do just merge the histograms
-    if(weighted)
-    {
-        for(size_t i=0; i<hists.size(); ++i)
-        {
-            const auto &data = hists[i].get_data();
-            const double &theta = thetas[i];
-
-            std::vector<double> corrected;
-            for(size_t j=0; j<data.size(); ++j)
-                corrected.push_back(correct_bias(centers[j], theta, data[j]));
-
-            write_to_stream(osCorrected, centers, corrected);
-
-            corrected_data.emplace_back(std::move(corrected));
-        }
-    }
-    else
+    std::vector<Corrected> corrected_data;
+    for(size_t i=0; i<hists.size(); ++i)
     {
-        for(size_t i=0; i<hists.size(); ++i)
+        Corrected corrected;
+        corrected.first = hists[i].window_begin();
+        corrected.weighted = weighted;
+        corrected.theta = weighted ? thetas[i] : 0;
+        corrected.shift = 0;
+        corrected.centers = &centers;
+
+        for(int j=hists[i].window_begin(); j<hists[i].window_end(); ++j)
         {
-            const auto &data = hists[i].get_data();
-
-            std::vector<double> corrected;
+            const double data = hists[i].at(j);
+            // if no temperatures are given, do just merge the histograms
+            if(weighted)
+                corrected.values.push_back(correct_bias(centers[j], thetas[i], data));
             // if we get histograms, we assume that they originate from WL
             // we will replace zeros by nan for nicer plots
             // if we want to evaluate simple sampling, we need to pass
             // infinite theta
-            for(size_t j=0; j<data.size(); ++j)
-                if(data[j] <= 0)
-                    corrected.push_back(std::nan(""));
-                else
-                    corrected.push_back(data[j]);
-
-            write_to_stream(osCorrected, centers, corrected);
-
-            corrected_data.emplace_back(std::move(corrected));
+            else if(data <= 0)
+                corrected.values.push_back(std::nan(""));
+            else
+                corrected.values.push_back(data);
         }
+
+        diagnostics.corrected(centers, corrected.first, corrected.values);
+        corrected_data.emplace_back(std::move(corrected));
     }
 
     std::vector<double> Zs = determineZ(hists, corrected_data, threshold, weighted, thetas);
 
     for(size_t i=1; i<hists.size(); ++i)
-        for(size_t j=0; j<corrected_data[i].size(); ++j)
-            corrected_data[i][j] += Zs[i];
+    {
+        corrected_data[i].shift = Zs[i];
+        for(auto &value : corrected_data[i].values)
+            value += Zs[i];
+    }
 
-    for(size_t i=0; i<hists.size(); ++i)
-        write_to_stream(osGlued, centers, corrected_data[i]);
+    for(const auto &corrected : corrected_data)
+        diagnostics.glued(centers, corrected.first, corrected.values);
 
     std::vector<double> unnormalized_data;
     if(hists.size() > 1)
     {
         // get data from all histograms and calculate weighted means
-        for(size_t j=0; j<corrected_data[0].size(); ++j)
+        for(int j=0; j<num_bins; ++j)
         {
             double total = 0;
             double total_weight = 0;
@@ -175,7 +191,7 @@ Histogram glueHistograms(const std::vector<Histogram> &hists, const std::vector<
                 for(size_t i=0; i<hists.size(); ++i)
                 {
                     double value = corrected_data[i][j];
-                    double weight = hists[i].get_data()[j];
+                    double weight = hists[i].at(j);
                     if(weight > threshold)
                     {
                         total += value * weight;
@@ -199,7 +215,8 @@ Histogram glueHistograms(const std::vector<Histogram> &hists, const std::vector<
     else
     {
         // if we have only one histogram, we do not need to average
-        unnormalized_data = corrected_data[0];
+        for(int j=0; j<num_bins; ++j)
+            unnormalized_data.push_back(corrected_data[0][j]);
     }
 
     std::vector<double> expData;
@@ -219,37 +236,55 @@ Histogram glueHistograms(const std::vector<Histogram> &hists, const std::vector<
         if(unnormalized_data[i] > -1e300 && unnormalized_data[i] < 1e300)
         {
             expData.push_back(std::exp(unnormalized_data[i]-m));
-            expCenters.push_back(hists[0].centers()[i]);
+            expCenters.push_back(centers[i]);
         }
     }
     double logArea = m + std::log(trapz(expCenters, expData));
     LOG(LOG_DEBUG) << "area: " << logArea;
 
-    Histogram out(hists[0].borders());
+    Histogram out(hists[0].layout());
     for(size_t i=0; i<unnormalized_data.size(); ++i)
         out.at(i) = unnormalized_data[i] - logArea;
 
-    osFinished << out.ascii_table();
+    diagnostics.finished(out);
 
     return out;
 }
 
+/** Glue histograms and write the intermediate results into the files
+ * named by gp, see FileDiagnostics.
+ */
+Histogram glueHistograms(const std::vector<Histogram> &hists, const std::vector<double> thetas, int threshold, const GnuplotData gp)
+{
+    FileDiagnostics diagnostics(gp);
+    return glueHistograms(hists, thetas, threshold, diagnostics);
+}
+
 /** Takes a bootstrap sample of histograms, glues them and returns
  * a table with an error estimate obtained from bootstrapping.
+ *
+ * The replicas are glued in parallel without any output, only the
+ * intermediate results of the last one are written for the plots.
  */
-std::string bootstrapGlueing(const std::vector<std::vector<Histogram>> &histograms, const std::vector<double> thetas, int threshold)
+std::string bootstrapGlueing(const std::vector<std::vector<Histogram>> &histograms, const std::vector<double> thetas, int threshold, const GnuplotData gp)
 {
     int num_bins = histograms[0][0].get_num_bins();
     int n_sample = histograms.size();
     std::vector<double> centers;
-    std::vector<std::vector<double>> tmp(num_bins);
+    std::vector<std::vector<double>> tmp(num_bins, std::vector<double>(n_sample));
 
     centers = histograms[0][0].centers();
+    NullDiagnostics none;
+    #pragma omp parallel for schedule(dynamic)
     for(int j=0; j<n_sample; ++j)
     {
-        Histogram h = glueHistograms(histograms[j], thetas, threshold);
+        Histogram h;
+        if(j < n_sample - 1)
+            h = glueHistograms(histograms[j], thetas, threshold, none);
+        else
+            h = glueHistograms(histograms[j], thetas, threshold, gp);
         for(int i=0; i<num_bins; ++i)
-            tmp[i].push_back(h.at(i));
+            tmp[i][j] = h.at(i);
     }
 
     std::vector<double> values(num_bins);
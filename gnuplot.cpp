@@ -1,4 +1,6 @@
 #include "gnuplot.hpp"
+#include "ColumnFile.hpp"
+#include "Decompressor.hpp"
 
 /** Write a gnuplot script visualizing the output for quality assessment.
  *
@@ -32,8 +34,20 @@ void write_gnuplot_quality(const GnuplotData &gp)
     int idx = 0;
     for(auto &s : gp.raw_names)
     {
-        if(has_suffix(s, ".gz"))
-            os << "'< zcat " << s << "' every 100 u 0:" << (gp.column + 1) << ":(" << idx << ") w l palette, \\\n";
+        ColumnFile columns(s);
+        if(columns.good() && gp.column < columns.columns())
+        {
+            os << "'" << s << "' binary skip=" << columns.offset(gp.column)
+               << " record=" << columns.rows()
+               << " format='" << (columns.dtype() == ColumnFile::FLOAT32 ? "%float32" : "%float64") << "'"
+               << " every 100 u 0:1:(" << idx << ") w l palette, \\\n";
+            ++idx;
+            continue;
+        }
+
+        const std::string decompress = decompressCommand(s);
+        if(!decompress.empty())
+            os << "'< " << decompress << " " << s << "' every 100 u 0:" << (gp.column + 1) << ":(" << idx << ") w l palette, \\\n";
         else
             os << "'" << s << "' every 100 u 0:" << (gp.column + 1) << ":(" << idx << ") w l palette, \\\n";
         ++idx;
@@ -28,15 +28,16 @@ struct GnuplotData {
     {
     }
 
-    GnuplotData(const Cmd &o)
-        : hist_name("hist.dat"),
-          corrected_name("corrected.dat"),
-          glued_name("glued.dat"),
-          finished_name("finished.dat"),
-          gnuplot_name(o.output + ".gp"),
+    /// names for the c-th of the evaluated columns, see Cmd::columnName
+    GnuplotData(const Cmd &o, size_t c=0)
+        : hist_name(o.columnName("hist.dat", c)),
+          corrected_name(o.columnName("corrected.dat", c)),
+          glued_name(o.columnName("glued.dat", c)),
+          finished_name(o.columnName("finished.dat", c)),
+          gnuplot_name(o.columnName(o.output, c) + ".gp"),
           raw_names(o.data_path_vector),
           temperatures(o.thetas),
-          column(o.column)
+          column(o.columns[c])
     {
     }
 };
@@ -2,11 +2,14 @@
 #include <vector>
 #include <algorithm>
 #include <chrono>
+#include <map>
 
 #include <fstream>
-#include "gzstream/gzstream.h"
 
 #include "Cmd.hpp"
+#include "ColumnFile.hpp"
+#include "HistogramCache.hpp"
+#include "FileStatistics.hpp"
 #include "fileOp.hpp"
 #include "glue.hpp"
 #include "autocorrelation.hpp"
@@ -18,13 +21,82 @@
  *
  */
 
+/** Whether the files should be read one after another, each by all threads.
+ *
+ * This is the case, if there are fewer files than threads and all of
+ * them can be split, such that the threads would idle otherwise.
+ */
+bool splitFiles(const std::vector<std::string> &files)
+{
+    if(files.size() >= (size_t) omp_get_max_threads())
+        return false;
+    for(const auto &file : files)
+        if(!canSplit(file))
+            return false;
+    return true;
+}
+
+/// borders of the histograms of one column
+struct Range
+{
+    double lower;
+    double upper;
+};
+
+/// statistics of column c of a file gathered by an ingestion, see FileStatistics
+FileStatistics::Column columnStatistics(const Cmd &o, const std::string &file, size_t c, const Ingestion &ingestion)
+{
+    FileStatistics::Column stats;
+    stats.column = o.columns[c];
+    stats.skip = o.skip;
+    stats.min = ingestion.minimum();
+    stats.max = ingestion.maximum();
+    stats.tau = o.step ? 0 : ingestion.tau();
+    stats.equilibration = -1;
+    if(!ingestion.samples().empty())
+    {
+        stats.equilibration = o.skip + (int64_t) equilibrationTime(ingestion.samples()) * ingestion.step();
+        LOG(LOG_DEBUG) << file << " column " << o.columns[c] << ": estimated t_eq = " << stats.equilibration;
+    }
+    return stats;
+}
+
+/** Use the autocorrelation times estimated by earlier evaluations of
+ * the same files, such that the steps are known before reading.
+ *
+ * Only if the last line of the file is complete, since otherwise
+ * the earlier evaluation may have ignored it.
+ */
+void useKnownTau(const Cmd &o, const FileStatistics &stats, const std::vector<int> &columns, std::vector<Ingestion> &ingestions)
+{
+    if(o.step || !stats.complete())
+        return;
+    for(size_t k=0; k<ingestions.size(); ++k)
+    {
+        const FileStatistics::Column *known = stats.find(columns[k], o.skip);
+        if(known && known->tau > 0)
+            ingestions[k].useTau(known->tau);
+    }
+}
+
 /** If the borders have their default values ([0, 0]), obtain
  * tight borders from the files
+ *
+ * Raw border files are evaluated completely on the way, with deferred
+ * binning, such that they do not need to be read again. All columns
+ * are evaluated in the same pass, every column gets its own borders.
+ * Files, whose ranges are known from their statistics, are not read.
+ *
+ * \param[out] ranges  borders for every column
+ * \return evaluations of the raw border files (one per column), keyed by their name
  */
-void updateBorders(Cmd &o)
+std::map<std::string, std::vector<Ingestion>> updateBorders(Cmd &o, std::vector<Range> &ranges)
 {
     std::chrono::high_resolution_clock::time_point t1 = std::chrono::high_resolution_clock::now();
 
+    const size_t num_columns = o.columns.size();
+    ranges.assign(num_columns, Range{o.lowerBound, o.upperBound});
+
     // if no borders are given, determine the borders from the first
     // and the last of the given data files
     if(o.border_path_vector.empty() && o.lowerBound < 0 && o.upperBound < 0)
@@ -34,15 +106,20 @@ void updateBorders(Cmd &o)
             o.border_path_vector.push_back(o.data_path_vector.back());
     }
 
+    std::map<std::string, std::vector<Ingestion>> ingested;
     if(!o.border_path_vector.empty())
     {
         LOG(LOG_INFO) << "determine borders from files (" << o.border_path_vector.size() << " given)";
 
-        double lower = 1e300;
-        double upper = -1e300;
+        const size_t num_files = o.border_path_vector.size();
+        std::vector<std::vector<Ingestion>> ingestions(num_files, std::vector<Ingestion>(num_columns, Ingestion(o.skip, o.step)));
+        std::vector<std::vector<Range>> file_ranges(num_files, std::vector<Range>(num_columns, Range{1e300, -1e300}));
+        std::vector<int> raw(num_files, 0);
+        std::vector<int> hist_bins(num_files, 0);
+        const bool split = splitFiles(o.border_path_vector);
 
-        #pragma omp parallel for reduction(min:lower), reduction(max:upper)
-        for(size_t i=0; i<o.border_path_vector.size(); ++i)
+        #pragma omp parallel for if(!split)
+        for(size_t i=0; i<num_files; ++i)
         {
             const auto &file = o.border_path_vector[i];
             LOG(LOG_DEBUG) << "read: " << file;
@@ -50,25 +127,85 @@ void updateBorders(Cmd &o)
             if(isHistogramFile(file))
             {
                 Histogram h(file);
-                lower = std::min(lower, h.borders().front());
-                upper = std::max(upper, h.borders().back());
-                o.num_bins = h.get_num_bins();
+                for(auto &range : file_ranges[i])
+                    range = Range{h.borders().front(), h.borders().back()};
+                hist_bins[i] = h.get_num_bins();
             }
             else
             {
-                // igzstream can also read plain files
-                igzstream is(file.c_str());
-                bordersFromStream(is, lower, upper, o.column, o.skip);
+                FileStatistics stats;
+                stats.load(file);
+
+                bool known = true;
+                for(size_t c=0; c<num_columns; ++c)
+                {
+                    const FileStatistics::Column *column = stats.find(o.columns[c], o.skip);
+                    if(!column || !column->hasRange())
+                        known = false;
+                    else
+                        file_ranges[i][c] = Range{column->min, column->max};
+                }
+                if(known)
+                {
+                    for(auto &range : file_ranges[i])
+                        Ingestion::widen(range.lower, range.upper);
+                    LOG(LOG_DEBUG) << "use range of " << file << " from its statistics";
+                    continue;
+                }
+
+                raw[i] = 1;
+                for(auto &ingestion : ingestions[i])
+                    ingestion.trackRange();
+                useKnownTau(o, stats, o.columns, ingestions[i]);
+
+                ingestFile(file, ingestions[i], o.columns, split, &stats);
+
+                // widen the range of every file on its own, independent
+                // of how the files are distributed over the threads
+                for(size_t c=0; c<num_columns; ++c)
+                {
+                    file_ranges[i][c] = Range{1e300, -1e300};
+                    ingestions[i][c].range(file_ranges[i][c].lower, file_ranges[i][c].upper);
+                    stats.update(columnStatistics(o, file, c, ingestions[i][c]));
+                }
+                stats.save();
             }
         }
-        o.lowerBound = lower;
-        o.upperBound = upper;
-        LOG(LOG_INFO) << "use range [" << o.lowerBound << ", " << o.upperBound<< "]";
+
+        for(size_t c=0; c<num_columns; ++c)
+        {
+            ranges[c] = Range{1e300, -1e300};
+            for(size_t i=0; i<num_files; ++i)
+            {
+                ranges[c].lower = std::min(ranges[c].lower, file_ranges[i][c].lower);
+                ranges[c].upper = std::max(ranges[c].upper, file_ranges[i][c].upper);
+            }
+            LOG(LOG_INFO) << "use range [" << ranges[c].lower << ", " << ranges[c].upper << "] for column " << o.columns[c];
+        }
+        for(size_t i=0; i<num_files; ++i)
+            if(hist_bins[i])
+                o.num_bins = hist_bins[i];
+
+        // now that the borders are known, bin the deferred samples
+        #pragma omp parallel for schedule(dynamic,1)
+        for(size_t k=0; k<num_files*num_columns; ++k)
+        {
+            const size_t i = k / num_columns;
+            const size_t c = k % num_columns;
+            if(raw[i])
+                ingestions[i][c].bin(o.num_bins, ranges[c].lower, ranges[c].upper);
+        }
+
+        for(size_t i=0; i<num_files; ++i)
+            if(raw[i])
+                ingested.emplace(o.border_path_vector[i], std::move(ingestions[i]));
     }
 
     std::chrono::high_resolution_clock::time_point t2 = std::chrono::high_resolution_clock::now();
     std::chrono::duration<double> time_span = std::chrono::duration_cast<std::chrono::duration<double>>(t2 - t1);
     LOG(LOG_TIMING) << "determining borders " << time_span.count() << "s";
+
+    return ingested;
 }
 
 /** test if all borders are the same
@@ -77,38 +214,47 @@ void updateBorders(Cmd &o)
  * If we load finished histograms, we do not have control over
  * the borders.
  */
-bool sameBorders(std::vector<Histogram> histograms)
+bool sameBorders(const std::vector<Histogram> &histograms)
 {
     const std::vector<double> &reference = histograms[0].borders();
     for(size_t i=1; i<histograms.size(); ++i)
     {
-        const std::vector<double> &cmp = histograms[i].borders();
-        if(reference.size() != cmp.size())
-            return false;
-        for(size_t j=0; j<reference.size(); ++j)
-            if(reference[j] != cmp[j])
-                return false;
+        // histograms with the same binning share their layout
+        if(histograms[i].layout() == histograms[0].layout())
+            continue;
 
+        if(reference != histograms[i].borders())
+            return false;
     }
     return true;
 }
 
+/// fingerprint of the histogram of column c of a file, see HistogramCache
+HistogramCache::Fingerprint cacheKey(const Cmd &o, const std::vector<Range> &ranges, const std::string &file, size_t c)
+{
+    return HistogramCache::fingerprint(file, o.columns[c], o.skip, o.step, o.num_bins, ranges[c].lower, ranges[c].upper);
+}
+
 /** Create Histograms from the specified files.
  *
- * If the files are already histograms or if there is an already
- * calculated cached histogram, use those, otherwise generate the
- * histograms from raw data.
+ * If the files are already histograms, were already evaluated while
+ * determining the borders or if there is an already calculated cached
+ * histogram, use those, otherwise generate the histograms from raw data.
+ * All columns without a usable histogram are read in a single pass.
+ *
+ * \return histograms of every column (outer) of every file (inner)
  */
-std::vector<Histogram> createHistograms(const Cmd &o)
+std::vector<std::vector<Histogram>> createHistograms(const Cmd &o, const std::vector<Range> &ranges, const std::map<std::string, std::vector<Ingestion>> &ingested)
 {
     std::chrono::high_resolution_clock::time_point t2 = std::chrono::high_resolution_clock::now();
 
-    std::vector<Histogram> histograms(o.data_path_vector.size());
+    const size_t num_columns = o.columns.size();
+    std::vector<std::vector<Histogram>> histograms(num_columns, std::vector<Histogram>(o.data_path_vector.size()));
+    const bool split = splitFiles(o.data_path_vector);
 
-    #pragma omp parallel for schedule(dynamic,1)
+    #pragma omp parallel for schedule(dynamic,1) if(!split)
     for(size_t i=0; i<o.data_path_vector.size(); ++i)
     {
-        int step = o.step;
         const auto &file = o.data_path_vector[i];
         LOG(LOG_DEBUG) << "read: " << file;
 
@@ -117,62 +263,149 @@ std::vector<Histogram> createHistograms(const Cmd &o)
         // then test, if o.lower/upper and num bins are the same, if not discard
         // else evaluate the datafile
 
-        Histogram tmp_hist;
         // if we give an explicit histogram, use it
         if(isHistogramFile(file))
         {
-            tmp_hist = Histogram(file);
-            histograms[i] = Histogram(o.num_bins, o.lowerBound, o.upperBound);
-            auto centers = tmp_hist.centers();
-            auto data = tmp_hist.get_data();
-
-            // fill the values into our newly binned histogram, but omit the left and righ most `threshold` bins
-            for(int j=o.threshold; j<tmp_hist.get_num_bins() - o.threshold; ++j)
+            Histogram tmp_hist(file);
+            for(size_t c=0; c<num_columns; ++c)
             {
-                histograms[i].add(centers[j], data[j]);
+                histograms[c][i] = Histogram(o.num_bins, ranges[c].lower, ranges[c].upper);
+
+                // distribute the values onto our newly binned histogram, but omit the left and righ most `threshold` bins
+                histograms[c][i].rebin(tmp_hist, o.threshold, tmp_hist.get_num_bins() - o.threshold);
             }
 
             LOG(LOG_DEBUG) << "load histogram from " << file;
         }
-        else
+        else if(ingested.count(file))
         {
-            // else see, if we have a temporary histogram cached
-            if(fileReadable(file+".hist") && !o.force)
-                tmp_hist = Histogram(file+".hist");
-
-            // if it does not fit, calculate new
-            if(!o.force
-            && tmp_hist.get_num_bins() == o.num_bins
-            && std::abs(o.lowerBound - tmp_hist.borders().front()) < 1e-1
-            && std::abs(o.upperBound - tmp_hist.borders().back()) < 1e-1
-            )
+            for(size_t c=0; c<num_columns; ++c)
             {
-                histograms[i] = std::move(tmp_hist);
-                LOG(LOG_DEBUG) << "load histogram for " << file;
+                const Ingestion &ingestion = ingested.at(file)[c];
+                histograms[c][i] = ingestion.histogram();
+
+                // save histogram to load it the next time ~ cache
+                const auto key = cacheKey(o, ranges, file, c);
+                const HistogramCache::Progress unknown{0, 0, 0};
+                HistogramCache::save(HistogramCache::fileName(o.columnName(file + ".hist", c), file, key), file, key, histograms[c][i], ingestion.tau(), unknown);
             }
-            else
+            LOG(LOG_DEBUG) << "use histogram for " << file << " from determining the borders";
+        }
+        else
+        {
+            // columns, which need to be read from the raw data
+            std::vector<int> columns;
+            std::vector<size_t> targets;
+            std::vector<HistogramCache::Fingerprint> keys;
+            // cached histograms of the beginning of the data and how far it was evaluated
+            std::vector<Histogram> previous;
+            std::vector<HistogramCache::Progress> progress;
+            std::vector<double> taus;
+
+            for(size_t c=0; c<num_columns; ++c)
             {
-                LOG(LOG_DEBUG) << "calculate histogram for " << file;
-
-                if(!o.step)
+                const auto key = cacheKey(o, ranges, file, c);
+                const std::string cache = HistogramCache::fileName(o.columnName(file + ".hist", c), file, key);
+
+                // else see, if we have a histogram cached, which was
+                // evaluated with the same arguments from the same data,
+                // or from its beginning, if data was appended since
+                // if it does not fit, calculate new
+                Histogram cached;
+                HistogramCache::Progress done{0, 0, 0};
+                double tau = 0;
+                HistogramCache::Match match = HistogramCache::MISS;
+                if(!o.force)
+                    match = HistogramCache::load(cache, file, key, cached, tau, done);
+
+                if(match == HistogramCache::COMPLETE)
                 {
-                    // igzstream can also read plain files
-                    igzstream is(file.c_str());
-                    double tau = tauFromStream(is, o.column, o.skip);
-                    step = std::ceil(2*tau);
+                    histograms[c][i] = std::move(cached);
+                    LOG(LOG_DEBUG) << "load histogram for " << file << " column " << o.columns[c] << ", tau = " << tau;
+                    continue;
                 }
+                // histograms with other bins can be derived from cached samples
+                if(match == HistogramCache::MISS && !o.force)
+                {
+                    const std::string samples = HistogramCache::fileName(o.columnName(file + ".samples", c), file, HistogramCache::unbinned(key));
+                    if(HistogramCache::loadSamples(samples, key, cached, tau) == HistogramCache::COMPLETE)
+                    {
+                        histograms[c][i] = std::move(cached);
+                        LOG(LOG_DEBUG) << "bin cached samples of " << file << " column " << o.columns[c] << ", tau = " << tau;
+                        continue;
+                    }
+                }
+                if(match == HistogramCache::MISS)
+                    done.offset = 0;
+
+                columns.push_back(o.columns[c]);
+                targets.push_back(c);
+                keys.push_back(key);
+                previous.push_back(std::move(cached));
+                progress.push_back(done);
+                taus.push_back(tau);
+            }
 
-                // I can not reset the igzstream somehow
-                igzstream is(file.c_str());
-                LOG(LOG_DEBUG) << file << ": t_eq = " << o.skip << ", tau = " << step;
-                histograms[i] = histogramFromStream(is, o.num_bins, o.lowerBound, o.upperBound, o.column, o.skip, step);
-
-                // save histogram to load it the next time ~ cache
-                histograms[i].writeToFile(file + ".hist");
+            if(!columns.empty())
+            {
+                // all columns are read in one pass, so continue only, if
+                // all of them were evaluated up to the same line before
+                uint64_t offset = progress[0].offset;
+                for(const auto &p : progress)
+                    if(p.offset != offset)
+                        offset = 0;
+
+                FileStatistics stats;
+                stats.load(file);
+
+                std::vector<Ingestion> ingestions;
+                for(size_t k=0; k<columns.size(); ++k)
+                {
+                    const size_t c = targets[k];
+                    ingestions.emplace_back(o.skip, offset ? progress[k].step : o.step);
+                    ingestions.back().bin(o.num_bins, ranges[c].lower, ranges[c].upper);
+                    if(offset)
+                        ingestions.back().resume(progress[k].lines);
+                    else if(o.sample_cache)
+                        ingestions.back().keepSamples();
+                }
+                if(!offset)
+                    useKnownTau(o, stats, columns, ingestions);
+
+                uint64_t end = 0;
+                if(offset)
+                    LOG(LOG_DEBUG) << "evaluate data appended to " << file << " after byte " << offset << " for columns " << columns;
+                else
+                    LOG(LOG_DEBUG) << "calculate histograms for " << file << " columns " << columns;
+                if(canAppend(file))
+                    end = ingestAppended(file, offset, ingestions, columns, split, &stats);
+                else
+                    ingestFile(file, ingestions, columns, split, &stats);
+
+                for(size_t k=0; k<ingestions.size(); ++k)
+                {
+                    const size_t c = targets[k];
+                    const double tau = offset ? taus[k] : ingestions[k].tau();
+                    LOG(LOG_DEBUG) << file << " column " << columns[k] << ": t_eq = " << o.skip << ", tau = " << ingestions[k].step();
+                    histograms[c][i] = ingestions[k].histogram();
+                    if(offset)
+                        histograms[c][i] += previous[k];
+
+                    // save histogram to load it the next time ~ cache
+                    const HistogramCache::Progress done{end, ingestions[k].lines(), ingestions[k].step()};
+                    HistogramCache::save(HistogramCache::fileName(o.columnName(file + ".hist", c), file, keys[k]), file, keys[k], histograms[c][i], tau, done);
+                    if(!offset && o.sample_cache)
+                        HistogramCache::saveSamples(HistogramCache::fileName(o.columnName(file + ".samples", c), file, HistogramCache::unbinned(keys[k])), keys[k], ingestions[k].samples(), tau);
+                    if(!offset)
+                        stats.update(columnStatistics(o, file, c, ingestions[k]));
+                }
+                stats.save();
             }
         }
     }
 
+    HistogramCache::evict();
+
     std::chrono::high_resolution_clock::time_point t3 = std::chrono::high_resolution_clock::now();
     std::chrono::duration<double> time_span = std::chrono::duration_cast<std::chrono::duration<double>>(t3 - t2);
     LOG(LOG_TIMING) << "reading files and creating histograms " << time_span.count() << "s";
@@ -180,72 +413,91 @@ std::vector<Histogram> createHistograms(const Cmd &o)
     return histograms;
 }
 
-std::vector<std::vector<Histogram>> bootstrapHistograms(Cmd &o, int n_sample, int seed=0)
+/** Create bootstrap samples of the histograms of the specified files.
+ *
+ * Every sample is a multinomial draw from the counts of the histogram,
+ * see BasicHistogram::resample(), such that only the histograms are
+ * needed, which may be cached or given as histogram files.
+ *
+ * \param histograms  histograms of every column (outer) of every file (inner)
+ * \return histograms of every column (outer) of every sample of every file (inner)
+ */
+std::vector<std::vector<std::vector<Histogram>>> bootstrapHistograms(const Cmd &o, const std::vector<std::vector<Histogram>> &histograms, int n_sample, int seed=0)
 {
     std::chrono::high_resolution_clock::time_point t2 = std::chrono::high_resolution_clock::now();
 
-    std::vector<std::vector<Histogram>> histograms(n_sample);
-    for(int i=0; i<n_sample; ++i)
-        histograms[i].resize(o.data_path_vector.size());
+    const size_t num_columns = o.columns.size();
+    const size_t num_files = o.data_path_vector.size();
+    std::vector<std::vector<std::vector<Histogram>>> samples(num_columns, std::vector<std::vector<Histogram>>(n_sample, std::vector<Histogram>(num_files)));
 
     #pragma omp parallel for schedule(dynamic,1)
-    for(size_t i=0; i<o.data_path_vector.size(); ++i)
+    for(size_t i=0; i<num_files; ++i)
     {
-        // this is dumb, but will generate the same random numbers
-        // independent of parallelism and it is good enough for bootstrapping
-        std::mt19937 rng(seed+i);
-
-        const auto &file = o.data_path_vector[i];
-        LOG(LOG_DEBUG) << "read: " << file;
-
-        if(!o.step)
+        for(size_t c=0; c<num_columns; ++c)
         {
-            // igzstream can also read plain files
-            igzstream is(file.c_str());
-            double tau = tauFromStream(is, o.column, o.skip);
-            o.step = std::ceil(2*tau);
-        }
+            // this is dumb, but will generate the same random numbers
+            // independent of parallelism and it is good enough for bootstrapping
+            std::mt19937 rng(seed+i);
 
-        // I can not reset the igzstream somehow
-        igzstream is(file.c_str());
-        LOG(LOG_DEBUG) << file << ": t_eq = " << o.skip << ", tau = " << o.step;
-        std::vector<double> numbers = vectorFromStream(is, o.column, o.skip, o.step);
-        size_t num_numbers = numbers.size();
-        std::uniform_int_distribution<int> uniform(0, num_numbers-1);
-
-        for(int j=0; j<n_sample; ++j)
-        {
-            Histogram h(o.num_bins, o.lowerBound, o.upperBound);
-            for(size_t k=0; k<num_numbers; ++k)
-            {
-                h.add(numbers[uniform(rng)]);
-            }
-            histograms[j][i] = h;
+            for(int j=0; j<n_sample; ++j)
+                samples[c][j][i] = histograms[c][i].resample(rng);
         }
     }
 
     std::chrono::high_resolution_clock::time_point t3 = std::chrono::high_resolution_clock::now();
     std::chrono::duration<double> time_span = std::chrono::duration_cast<std::chrono::duration<double>>(t3 - t2);
-    LOG(LOG_TIMING) << "reading files and bootstrapping histograms " << time_span.count() << "s";
+    LOG(LOG_TIMING) << "bootstrapping histograms " << time_span.count() << "s";
 
-    return histograms;
+    return samples;
+}
+
+/** Convert all input files to column files, see ColumnFile.
+ *
+ * \return number of files, which could not be converted
+ */
+int convertFiles(const Cmd &o)
+{
+    int failed = 0;
+    #pragma omp parallel for schedule(dynamic) reduction(+:failed)
+    for(size_t i=0; i<o.data_path_vector.size(); ++i)
+    {
+        const std::string &file = o.data_path_vector[i];
+        if(ColumnFile::isColumnFile(file))
+        {
+            LOG(LOG_WARNING) << file << " is already a column file";
+            continue;
+        }
+        if(!ColumnFile::convert(file, ColumnFile::fileName(file)))
+        {
+            LOG(LOG_ERROR) << "Can not convert " << file;
+            ++failed;
+        }
+    }
+    return failed;
 }
 
 int main(int argc, char** argv)
 {
     Cmd o(argc, argv);
 
-    updateBorders(o);
-    GnuplotData gp(o);
+    if(o.convert)
+        return convertFiles(o) ? 1 : 0;
+
+    std::vector<Range> ranges;
+    std::map<std::string, std::vector<Ingestion>> ingested = updateBorders(o, ranges);
+
+    std::vector<std::vector<Histogram>> histograms = createHistograms(o, ranges, ingested);
+    ingested.clear();
 
     if(!o.bootstrap)
     {
-        std::vector<Histogram> histograms = createHistograms(o);
-
         std::chrono::high_resolution_clock::time_point t3 = std::chrono::high_resolution_clock::now();
 
-        Histogram h = glueHistograms(histograms, o.thetas, o.threshold, gp);
-        write_out(o.output, h.ascii_table());
+        for(size_t c=0; c<o.columns.size(); ++c)
+        {
+            Histogram h = glueHistograms(histograms[c], o.thetas, o.threshold, GnuplotData(o, c));
+            write_out(o.columnName(o.output, c), h.ascii_table());
+        }
 
         std::chrono::high_resolution_clock::time_point t4 = std::chrono::high_resolution_clock::now();
         std::chrono::duration<double> time_span = std::chrono::duration_cast<std::chrono::duration<double>>(t4 - t3);
@@ -253,17 +505,21 @@ int main(int argc, char** argv)
     }
     else
     {
-        std::vector<std::vector<Histogram>> histogramSamples = bootstrapHistograms(o, o.threshold);
+        std::vector<std::vector<std::vector<Histogram>>> histogramSamples = bootstrapHistograms(o, histograms, o.threshold);
 
         std::chrono::high_resolution_clock::time_point t3 = std::chrono::high_resolution_clock::now();
 
-        std::string table = bootstrapGlueing(histogramSamples, o.thetas, o.threshold);
-        write_out(o.output, table);
+        for(size_t c=0; c<o.columns.size(); ++c)
+        {
+            std::string table = bootstrapGlueing(histogramSamples[c], o.thetas, o.threshold, GnuplotData(o, c));
+            write_out(o.columnName(o.output, c), table);
+        }
 
         std::chrono::high_resolution_clock::time_point t4 = std::chrono::high_resolution_clock::now();
         std::chrono::duration<double> time_span = std::chrono::duration_cast<std::chrono::duration<double>>(t4 - t3);
         LOG(LOG_TIMING) << "glueing histograms " << time_span.count() << "s";
     }
 
-    write_gnuplot_quality(gp);
+    for(size_t c=0; c<o.columns.size(); ++c)
+        write_gnuplot_quality(GnuplotData(o, c));
 }
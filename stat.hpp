@@ -3,6 +3,8 @@
 #include <algorithm>
 #include <numeric>
 #include <vector>
+#include <random>
+#include <cstdint>
 #include <cassert>
 
 /// calculates the mean of a vector
@@ -75,3 +77,44 @@ inline double histogram_mean(std::vector<double> x, std::vector<double> p)
         sum += (x[i+1] - x[i]) * (p[i+1]*x[i+1] + p[i]*x[i]);
     return sum/2;
 }
+
+/** Draws the counts of n trials distributed over categories with the
+ *  given (unnormalized) weights.
+ *
+ *  The categories are drawn one after another as binomials of the
+ *  remaining trials, conditional on the counts of the categories before,
+ *  such that it needs O(categories) instead of O(n) random numbers.
+ *  Categories with non-positive weights get no trials.
+ */
+template <typename RNG>
+std::vector<int64_t> multinomial(int64_t n, const std::vector<double> &weights, RNG &rng)
+{
+    std::vector<int64_t> counts(weights.size(), 0);
+    double remaining = 0;
+    int last = -1;
+    for(size_t k=0; k<weights.size(); ++k)
+        if(weights[k] > 0)
+        {
+            remaining += weights[k];
+            last = k;
+        }
+
+    for(int k=0; k<=last && n>0; ++k)
+    {
+        if(!(weights[k] > 0))
+            continue;
+
+        // the last category gets all remaining trials, whatever the rounding
+        if(k == last)
+            counts[k] = n;
+        else
+        {
+            const double p = remaining > weights[k] ? weights[k] / remaining : 1.;
+            std::binomial_distribution<int64_t> binomial(n, p);
+            counts[k] = binomial(rng);
+        }
+        n -= counts[k];
+        remaining -= weights[k];
+    }
+    return counts;
+}